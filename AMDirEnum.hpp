@@ -0,0 +1,678 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+#if !defined(_WIN32) && defined(__linux__)
+#include <dirent.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#endif
+
+namespace AMPathTools
+{
+    namespace fs = std::filesystem;
+
+    enum class EntryType
+    {
+        Unknown = 0,
+        File = 1,
+        Directory = 2,
+        Symlink = 3,
+        Other = 4
+    };
+
+    struct DirEntry
+    {
+        // UTF-8 名字, 只在下一次 Next 之前有效
+        std::string_view name;
+        EntryType type = EntryType::Unknown;
+        uint64_t inode = 0;
+    };
+
+    // UTF-8 名字转为 path, Windows 下需要经过宽字符
+    fs::path path_from_utf8(std::string_view name)
+    {
+#ifdef _WIN32
+        return fs::u8path(name.begin(), name.end());
+#else
+        return fs::path(name);
+#endif
+    }
+
+    // 文件的唯一标识: POSIX 为 (st_dev, st_ino), Windows 为 (卷序列号, 文件索引)
+    struct FileId
+    {
+        uint64_t device = 0;
+        uint64_t index = 0;
+
+        bool operator==(const FileId &other) const
+        {
+            return device == other.device && index == other.index;
+        }
+    };
+
+    // 跟随链接取得目标的标识, 目标不是目录时返回 false
+    bool get_dir_id(const fs::path &path, FileId &id)
+    {
+#ifdef _WIN32
+        HANDLE handle = CreateFileW(path.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+        if (handle == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        BY_HANDLE_FILE_INFORMATION info;
+        bool ok = GetFileInformationByHandle(handle, &info) && (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY);
+        CloseHandle(handle);
+        if (ok)
+        {
+            id.device = info.dwVolumeSerialNumber;
+            id.index = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+        }
+        return ok;
+#else
+        struct stat st;
+        if (::stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+        {
+            return false;
+        }
+        id.device = static_cast<uint64_t>(st.st_dev);
+        id.index = static_cast<uint64_t>(st.st_ino);
+        return true;
+#endif
+    }
+
+    // 单次元数据调用得到的信息; allocated 为实际占用的磁盘空间, 时间为秒级 Unix 时间;
+    // mode 与 uid 只在 POSIX 上有值, readonly 只在 Windows 上有值
+    struct EntryStat
+    {
+        EntryType type = EntryType::Unknown;
+        uint64_t size = 0;
+        uint64_t allocated = 0;
+        uint64_t links = 1;
+        FileId id;
+        uint64_t atime = 0;
+        uint64_t mtime = 0;
+        uint32_t mode = 0;
+        uint32_t uid = 0;
+        bool readonly = false;
+    };
+
+#ifdef _WIN32
+    uint64_t unix_time(const FILETIME &ft)
+    {
+        uint64_t ticks = (static_cast<uint64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+        // FILETIME 以 1601 年为起点, 单位 100ns
+        return ticks < 116444736000000000ull ? 0 : (ticks - 116444736000000000ull) / 10000000ull;
+    }
+
+    // GetFileAttributesExW 与 FindFirstFileW 返回的公共部分
+    void fill_entry_attributes(DWORD attributes, DWORD size_high, DWORD size_low, const FILETIME &access, const FILETIME &write, EntryStat &info)
+    {
+        info.size = (attributes & FILE_ATTRIBUTE_DIRECTORY) ? 0 : (static_cast<uint64_t>(size_high) << 32) | size_low;
+        info.atime = unix_time(access);
+        info.mtime = unix_time(write);
+        info.readonly = (attributes & FILE_ATTRIBUTE_READONLY) != 0;
+    }
+#else
+    EntryType entry_type(uint32_t mode)
+    {
+        return S_ISREG(mode) ? EntryType::File : S_ISDIR(mode) ? EntryType::Directory
+                                             : S_ISLNK(mode)   ? EntryType::Symlink
+                                                               : EntryType::Other;
+    }
+
+    void fill_entry_stat(const struct stat &st, EntryStat &info)
+    {
+        info.type = entry_type(st.st_mode);
+        info.size = static_cast<uint64_t>(st.st_size);
+        info.allocated = static_cast<uint64_t>(st.st_blocks) * 512;
+        info.links = static_cast<uint64_t>(st.st_nlink);
+        info.id.device = static_cast<uint64_t>(st.st_dev);
+        info.id.index = static_cast<uint64_t>(st.st_ino);
+        info.atime = static_cast<uint64_t>(st.st_atime);
+        info.mtime = static_cast<uint64_t>(st.st_mtime);
+        info.mode = static_cast<uint32_t>(st.st_mode);
+        info.uid = static_cast<uint32_t>(st.st_uid);
+    }
+
+#if defined(__linux__) && defined(STATX_BASIC_STATS)
+    void fill_entry_statx(const struct statx &stx, EntryStat &info)
+    {
+        info.type = entry_type(stx.stx_mode);
+        info.size = stx.stx_size;
+        info.allocated = stx.stx_blocks * 512;
+        info.links = stx.stx_nlink;
+        // 与 stat 的 st_dev 保持一致, FileId 可以与 get_dir_id 的结果比较
+        info.id.device = static_cast<uint64_t>(makedev(stx.stx_dev_major, stx.stx_dev_minor));
+        info.id.index = stx.stx_ino;
+        info.atime = static_cast<uint64_t>(stx.stx_atime.tv_sec);
+        info.mtime = static_cast<uint64_t>(stx.stx_mtime.tv_sec);
+        info.mode = stx.stx_mode;
+        info.uid = stx.stx_uid;
+    }
+#endif
+
+    // dirfd 为 AT_FDCWD 时 name 为完整路径; Linux 用 statx 只请求基本字段, 内核或 libc 不支持时退回 fstatat
+    bool stat_at(int dirfd, const char *name, EntryStat &info, bool follow)
+    {
+        int flags = follow ? 0 : AT_SYMLINK_NOFOLLOW;
+#if defined(__linux__) && defined(STATX_BASIC_STATS)
+        struct statx stx;
+        if (::statx(dirfd, name, flags, STATX_BASIC_STATS, &stx) == 0)
+        {
+            fill_entry_statx(stx, info);
+            return true;
+        }
+        if (errno != ENOSYS)
+        {
+            return false;
+        }
+#endif
+        struct stat st;
+        if (::fstatat(dirfd, name, &st, flags) != 0)
+        {
+            return false;
+        }
+        fill_entry_stat(st, info);
+        return true;
+    }
+#endif
+
+    // follow 为 false 时不跟随链接, 返回链接自身的信息
+    bool stat_path(const fs::path &path, EntryStat &info, bool follow)
+    {
+#ifdef _WIN32
+        HANDLE handle = CreateFileW(path.c_str(), FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                    FILE_FLAG_BACKUP_SEMANTICS | (follow ? 0 : FILE_FLAG_OPEN_REPARSE_POINT), nullptr);
+        if (handle == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        BY_HANDLE_FILE_INFORMATION data;
+        FILE_STANDARD_INFO standard;
+        bool ok = GetFileInformationByHandle(handle, &data) && GetFileInformationByHandleEx(handle, FileStandardInfo, &standard, sizeof(standard));
+        CloseHandle(handle);
+        if (!ok)
+        {
+            return false;
+        }
+        DWORD attributes = data.dwFileAttributes;
+        info.type = (!follow && (attributes & FILE_ATTRIBUTE_REPARSE_POINT)) ? EntryType::Symlink : (attributes & FILE_ATTRIBUTE_DIRECTORY) ? EntryType::Directory
+                                                                                                                                          : EntryType::File;
+        info.size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+        info.allocated = static_cast<uint64_t>(standard.AllocationSize.QuadPart);
+        info.links = data.nNumberOfLinks;
+        info.id.device = data.dwVolumeSerialNumber;
+        info.id.index = (static_cast<uint64_t>(data.nFileIndexHigh) << 32) | data.nFileIndexLow;
+        info.atime = unix_time(data.ftLastAccessTime);
+        info.mtime = unix_time(data.ftLastWriteTime);
+        info.readonly = (attributes & FILE_ATTRIBUTE_READONLY) != 0;
+        return true;
+#else
+        return stat_at(AT_FDCWD, path.c_str(), info, follow);
+#endif
+    }
+
+    // 只取类型, 大小, 时间与权限, 不保证 allocated / links / id;
+    // Windows 一次 GetFileAttributesExW, 只有跟随链接时才需要打开目标; 失败时 ec 为原因
+    bool stat_basic(const fs::path &path, EntryStat &info, bool follow, std::error_code &ec)
+    {
+#ifdef _WIN32
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data))
+        {
+            ec = std::error_code(static_cast<int>(GetLastError()), std::system_category());
+            return false;
+        }
+        DWORD attributes = data.dwFileAttributes;
+        if (attributes & FILE_ATTRIBUTE_REPARSE_POINT)
+        {
+            if (follow)
+            {
+                if (!stat_path(path, info, true))
+                {
+                    ec = std::error_code(static_cast<int>(GetLastError()), std::system_category());
+                    return false;
+                }
+                return true;
+            }
+            info.type = EntryType::Symlink;
+        }
+        else
+        {
+            info.type = (attributes & FILE_ATTRIBUTE_DIRECTORY) ? EntryType::Directory : EntryType::File;
+        }
+        fill_entry_attributes(attributes, data.nFileSizeHigh, data.nFileSizeLow, data.ftLastAccessTime, data.ftLastWriteTime, info);
+        return true;
+#else
+        if (!stat_at(AT_FDCWD, path.c_str(), info, follow))
+        {
+            ec = std::error_code(errno, std::generic_category());
+            return false;
+        }
+        return true;
+#endif
+    }
+
+    // 开放寻址 + 线性探测的 FileId 集合, 容量为 2 的幂, 负载超过一半时翻倍
+    class FileIdSet
+    {
+    public:
+        // 新插入时返回 true, 已存在时返回 false
+        bool Insert(const FileId &id)
+        {
+            if ((count + 1) * 2 > slots.size())
+            {
+                Grow();
+            }
+            size_t mask = slots.size() - 1;
+            for (size_t i = Hash(id) & mask;; i = (i + 1) & mask)
+            {
+                if (!used[i])
+                {
+                    used[i] = 1;
+                    slots[i] = id;
+                    count++;
+                    return true;
+                }
+                if (slots[i] == id)
+                {
+                    return false;
+                }
+            }
+        }
+
+        bool Contains(const FileId &id) const
+        {
+            if (slots.empty())
+            {
+                return false;
+            }
+            size_t mask = slots.size() - 1;
+            for (size_t i = Hash(id) & mask; used[i]; i = (i + 1) & mask)
+            {
+                if (slots[i] == id)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        size_t Size() const
+        {
+            return count;
+        }
+
+        void Clear()
+        {
+            slots.clear();
+            used.clear();
+            count = 0;
+        }
+
+    private:
+        std::vector<FileId> slots;
+        std::vector<uint8_t> used;
+        size_t count = 0;
+
+        static size_t Hash(const FileId &id)
+        {
+            uint64_t h = id.index * 0x9E3779B97F4A7C15ull ^ (id.device + 0x632BE59BD9B4E019ull + (id.index << 6));
+            h ^= h >> 29;
+            h *= 0xBF58476D1CE4E5B9ull;
+            h ^= h >> 32;
+            return static_cast<size_t>(h);
+        }
+
+        void Grow()
+        {
+            std::vector<FileId> old_slots = std::move(slots);
+            std::vector<uint8_t> old_used = std::move(used);
+            size_t capacity = old_slots.empty() ? 64 : old_slots.size() * 2;
+            slots.assign(capacity, FileId{});
+            used.assign(capacity, 0);
+            count = 0;
+            for (size_t i = 0; i < old_slots.size(); i++)
+            {
+                if (old_used[i])
+                {
+                    Insert(old_slots[i]);
+                }
+            }
+        }
+    };
+
+#if !defined(_WIN32) && defined(__linux__)
+    // getdents64 的缓冲区按线程复用; 遍历在进入子目录前先关闭当前目录, 每个线程通常只需一块,
+    // 最多保留 MaxRetained 块, 多出的直接释放
+    class DirBufferPool
+    {
+    public:
+        static constexpr size_t BufferSize = 256 * 1024;
+        static constexpr size_t MaxRetained = 2;
+
+        static std::unique_ptr<char[]> Acquire()
+        {
+            auto &pool = Buffers();
+            if (pool.empty())
+            {
+                return std::unique_ptr<char[]>(new char[BufferSize]);
+            }
+            auto buffer = std::move(pool.back());
+            pool.pop_back();
+            return buffer;
+        }
+
+        static void Release(std::unique_ptr<char[]> buffer)
+        {
+            auto &pool = Buffers();
+            if (buffer && pool.size() < MaxRetained)
+            {
+                pool.push_back(std::move(buffer));
+            }
+        }
+
+    private:
+        static std::vector<std::unique_ptr<char[]>> &Buffers()
+        {
+            thread_local std::vector<std::unique_ptr<char[]>> buffers;
+            return buffers;
+        }
+    };
+#endif
+
+    // 逐个返回目录中的条目 (不含 . 与 ..), 类型取自枚举结果本身, 不额外 stat;
+    // Linux: getdents64 + 大缓冲区; Windows: FindFirstFileExW(FIND_FIRST_EX_LARGE_FETCH); 其余平台: directory_iterator
+    class DirEnumerator
+    {
+    public:
+        explicit DirEnumerator(const fs::path &dir)
+#if defined(_WIN32) || !defined(__linux__)
+            : dir_path(dir)
+#endif
+        {
+#ifdef _WIN32
+            std::wstring pattern = (dir / L"*").wstring();
+            handle = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+            if (handle == INVALID_HANDLE_VALUE)
+            {
+                DWORD code = GetLastError();
+                // 盘符根目录没有 . 与 .., 为空时返回 ERROR_FILE_NOT_FOUND
+                if (code != ERROR_FILE_NOT_FOUND)
+                {
+                    error = std::error_code(static_cast<int>(code), std::system_category());
+                }
+                return;
+            }
+            pending = true;
+#elif defined(__linux__)
+            fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd < 0)
+            {
+                error = std::error_code(errno, std::generic_category());
+                return;
+            }
+            buffer = DirBufferPool::Acquire();
+#else
+            iter = fs::directory_iterator(dir, error);
+#endif
+        }
+
+        DirEnumerator(const DirEnumerator &) = delete;
+        DirEnumerator &operator=(const DirEnumerator &) = delete;
+
+        ~DirEnumerator()
+        {
+#ifdef _WIN32
+            if (handle != INVALID_HANDLE_VALUE)
+            {
+                FindClose(handle);
+            }
+#elif defined(__linux__)
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+            DirBufferPool::Release(std::move(buffer));
+#endif
+        }
+
+        bool IsOpen() const
+        {
+            return !error;
+        }
+
+        // 取得正在枚举的目录自身的标识; Linux 直接 fstat 已打开的描述符
+        bool GetId(FileId &id) const
+        {
+#if !defined(_WIN32) && defined(__linux__)
+            struct stat st;
+            if (fd < 0 || ::fstat(fd, &st) != 0)
+            {
+                return false;
+            }
+            id.device = static_cast<uint64_t>(st.st_dev);
+            id.index = static_cast<uint64_t>(st.st_ino);
+            return true;
+#else
+            return IsOpen() && get_dir_id(dir_path, id);
+#endif
+        }
+
+        // 当前条目的元数据; Linux 用 statx 相对已打开的目录, 不再重新解析整条路径
+        bool StatEntry(const DirEntry &entry, EntryStat &info, bool follow) const
+        {
+            stat_calls++;
+#if !defined(_WIN32) && defined(__linux__)
+            // 名字直接指向 getdents 缓冲区, 以 \0 结尾
+            return stat_at(fd, entry.name.data(), info, follow);
+#else
+            return stat_path(dir_path / path_from_utf8(entry.name), info, follow);
+#endif
+        }
+
+        // 与 stat_basic 相同的字段; Windows 直接取自枚举返回的数据, 只有跟随链接时才需要额外调用
+        bool StatBasic(const DirEntry &entry, EntryStat &info, bool follow) const
+        {
+#ifdef _WIN32
+            if (!(follow && (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)))
+            {
+                info.type = entry.type;
+                fill_entry_attributes(data.dwFileAttributes, data.nFileSizeHigh, data.nFileSizeLow, data.ftLastAccessTime, data.ftLastWriteTime, info);
+                return true;
+            }
+#endif
+            return StatEntry(entry, info, follow);
+        }
+
+        // 本枚举器发起的元数据调用次数
+        uint64_t GetStatCalls() const
+        {
+            return stat_calls;
+        }
+
+#if !defined(_WIN32) && defined(__linux__)
+        // 已打开目录的描述符, 供批量 statx 使用; 未打开时为 -1
+        int GetFd() const
+        {
+            return fd;
+        }
+
+        void AddStatCalls(uint64_t count) const
+        {
+            stat_calls += count;
+        }
+#endif
+
+        // 打开或读取失败时非空
+        const std::error_code &GetError() const
+        {
+            return error;
+        }
+
+        bool Next(DirEntry &entry)
+        {
+#ifdef _WIN32
+            while (handle != INVALID_HANDLE_VALUE)
+            {
+                if (!pending && !FindNextFileW(handle, &data))
+                {
+                    DWORD code = GetLastError();
+                    if (code != ERROR_NO_MORE_FILES)
+                    {
+                        error = std::error_code(static_cast<int>(code), std::system_category());
+                    }
+                    return false;
+                }
+                pending = false;
+                const wchar_t *wname = data.cFileName;
+                if (wname[0] == L'.' && (wname[1] == L'\0' || (wname[1] == L'.' && wname[2] == L'\0')))
+                {
+                    continue;
+                }
+                int wlen = static_cast<int>(std::wcslen(wname));
+                int len = WideCharToMultiByte(CP_UTF8, 0, wname, wlen, nullptr, 0, nullptr, nullptr);
+                name.resize(len > 0 ? len : 0);
+                if (len > 0)
+                {
+                    WideCharToMultiByte(CP_UTF8, 0, wname, wlen, &name[0], len, nullptr, nullptr);
+                }
+                entry.name = name;
+                entry.inode = 0;
+                DWORD attributes = data.dwFileAttributes;
+                if ((attributes & FILE_ATTRIBUTE_REPARSE_POINT) && (data.dwReserved0 == IO_REPARSE_TAG_SYMLINK || data.dwReserved0 == IO_REPARSE_TAG_MOUNT_POINT))
+                {
+                    entry.type = EntryType::Symlink;
+                }
+                else if (attributes & FILE_ATTRIBUTE_DIRECTORY)
+                {
+                    entry.type = EntryType::Directory;
+                }
+                else
+                {
+                    entry.type = EntryType::File;
+                }
+                return true;
+            }
+            return false;
+#elif defined(__linux__)
+            while (fd >= 0)
+            {
+                if (pos >= size)
+                {
+                    long n = ::syscall(SYS_getdents64, fd, buffer.get(), DirBufferPool::BufferSize);
+                    if (n <= 0)
+                    {
+                        if (n < 0)
+                        {
+                            error = std::error_code(errno, std::generic_category());
+                        }
+                        return false;
+                    }
+                    pos = 0;
+                    size = static_cast<size_t>(n);
+                }
+                const Dirent64 *record = reinterpret_cast<const Dirent64 *>(buffer.get() + pos);
+                pos += record->d_reclen;
+                const char *cname = record->d_name;
+                if (cname[0] == '.' && (cname[1] == '\0' || (cname[1] == '.' && cname[2] == '\0')))
+                {
+                    continue;
+                }
+                entry.name = std::string_view(cname, std::strlen(cname));
+                entry.inode = record->d_ino;
+                switch (record->d_type)
+                {
+                case DT_REG:
+                    entry.type = EntryType::File;
+                    break;
+                case DT_DIR:
+                    entry.type = EntryType::Directory;
+                    break;
+                case DT_LNK:
+                    entry.type = EntryType::Symlink;
+                    break;
+                case DT_UNKNOWN:
+                    entry.type = EntryType::Unknown;
+                    break;
+                default:
+                    entry.type = EntryType::Other;
+                    break;
+                }
+                return true;
+            }
+            return false;
+#else
+            if (error || iter == fs::directory_iterator())
+            {
+                return false;
+            }
+            if (started)
+            {
+                iter.increment(error);
+                if (error || iter == fs::directory_iterator())
+                {
+                    return false;
+                }
+            }
+            started = true;
+            name = iter->path().filename().string();
+            entry.name = name;
+            entry.inode = 0;
+            std::error_code ec;
+            fs::file_type type = iter->symlink_status(ec).type();
+            entry.type = type == fs::file_type::directory ? EntryType::Directory : type == fs::file_type::regular ? EntryType::File
+                                                                              : type == fs::file_type::symlink   ? EntryType::Symlink
+                                                                              : ec                               ? EntryType::Unknown
+                                                                                                                 : EntryType::Other;
+            return true;
+#endif
+        }
+
+    private:
+        std::error_code error;
+        mutable uint64_t stat_calls = 0;
+#if defined(_WIN32) || !defined(__linux__)
+        fs::path dir_path;
+#endif
+#ifdef _WIN32
+        HANDLE handle = INVALID_HANDLE_VALUE;
+        WIN32_FIND_DATAW data;
+        bool pending = false;
+        std::string name;
+#elif defined(__linux__)
+        struct Dirent64
+        {
+            uint64_t d_ino;
+            int64_t d_off;
+            unsigned short d_reclen;
+            unsigned char d_type;
+            char d_name[1];
+        };
+
+        int fd = -1;
+        std::unique_ptr<char[]> buffer;
+        size_t pos = 0;
+        size_t size = 0;
+#else
+        fs::directory_iterator iter;
+        bool started = false;
+        std::string name;
+#endif
+    };
+}
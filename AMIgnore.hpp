@@ -0,0 +1,349 @@
+#pragma once
+#include "AMPathMatch.hpp"
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace AMPathTools
+{
+    namespace fs = std::filesystem;
+
+    // gitignore 语法的排除规则; 每个 .gitignore 对应一层, 通过 parent 串起来, 深层的规则优先
+    class IgnoreRules
+    {
+    public:
+        IgnoreRules() = default;
+
+        // base 为本层规则所在目录相对遍历根的路径, 以 / 分隔, 根目录为空
+        IgnoreRules(std::shared_ptr<const IgnoreRules> parent, std::string base) : parent(std::move(parent)), base(std::move(base)) {}
+
+        // 从若干行规则构造根层
+        static std::shared_ptr<const IgnoreRules> FromLines(const std::vector<std::string> &lines)
+        {
+            auto rules = std::make_shared<IgnoreRules>();
+            for (auto &line : lines)
+            {
+                rules->Add(line);
+            }
+            return rules;
+        }
+
+        void Add(std::string_view line)
+        {
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.remove_suffix(1);
+            }
+            // 末尾未转义的空格忽略
+            while (!line.empty() && line.back() == ' ' && !(line.size() > 1 && line[line.size() - 2] == '\\'))
+            {
+                line.remove_suffix(1);
+            }
+            if (line.empty() || line.front() == '#')
+            {
+                return;
+            }
+            Rule rule;
+            if (line.front() == '!')
+            {
+                rule.negated = true;
+                line.remove_prefix(1);
+            }
+            if (!line.empty() && line.back() == '/')
+            {
+                rule.dir_only = true;
+                line.remove_suffix(1);
+            }
+            // 开头或中间带 / 时相对 base 锚定, 否则匹配任意层的名字
+            size_t slash = line.find('/');
+            rule.anchored = slash != std::string_view::npos;
+            if (!line.empty() && line.front() == '/')
+            {
+                line.remove_prefix(1);
+            }
+            if (line.empty())
+            {
+                return;
+            }
+            size_t start = 0;
+            while (start <= line.size())
+            {
+                size_t end = line.find('/', start);
+                if (end == std::string_view::npos)
+                {
+                    end = line.size();
+                }
+                if (end > start)
+                {
+                    rule.parts.push_back(GetCompiledPattern(Translate(line.substr(start, end - start)), false));
+                }
+                start = end + 1;
+            }
+            if (!rule.parts.empty())
+            {
+                rules.push_back(std::move(rule));
+            }
+        }
+
+        // 读取一个 .gitignore 文件, 返回是否读到了规则
+        bool AddFile(const fs::path &file)
+        {
+            std::ifstream in(file, std::ios::binary);
+            if (!in)
+            {
+                return false;
+            }
+            size_t before = rules.size();
+            std::string line;
+            while (std::getline(in, line))
+            {
+                Add(line);
+            }
+            return rules.size() > before;
+        }
+
+        bool Empty() const
+        {
+            return rules.empty();
+        }
+
+        // dir 为条目所在目录相对遍历根的路径, name 为条目名
+        bool IsIgnored(std::string_view dir, std::string_view name, bool is_dir) const
+        {
+            for (const IgnoreRules *frame = this; frame; frame = frame->parent.get())
+            {
+                int decision = frame->Decide(dir, name, is_dir);
+                if (decision >= 0)
+                {
+                    return decision == 1;
+                }
+            }
+            return false;
+        }
+
+    private:
+        struct Rule
+        {
+            std::vector<PatternPtr> parts;
+            bool negated = false;
+            bool dir_only = false;
+            bool anchored = false;
+        };
+
+        std::shared_ptr<const IgnoreRules> parent;
+        std::string base;
+        std::vector<Rule> rules;
+
+        // gitignore 中 \ 转义下一个字符, { } 没有特殊含义; 统一改写成单字符的 [..], [...] 内部原样保留
+        static std::string Translate(std::string_view segment)
+        {
+            std::string result;
+            for (size_t i = 0; i < segment.size(); i++)
+            {
+                char c = segment[i];
+                if (c == '\\' && i + 1 < segment.size())
+                {
+                    c = segment[++i];
+                    if (c == '*' || c == '?' || c == '[' || c == '{' || c == '}')
+                    {
+                        result += '[';
+                        result += c;
+                        result += ']';
+                        continue;
+                    }
+                    result += c;
+                }
+                else if (c == '[')
+                {
+                    size_t end = ClassEnd(segment, i);
+                    if (end == std::string_view::npos)
+                    {
+                        // 未闭合的 [ 是字面量, 写成 [[] 以免与后面改写出的 [..] 配对
+                        result += "[[]";
+                        continue;
+                    }
+                    // 集合内的 { } 本身就是字面量, 只去掉转义用的反斜杠
+                    for (; i <= end; i++)
+                    {
+                        if (segment[i] == '\\' && i + 1 < end)
+                        {
+                            i++;
+                        }
+                        result += segment[i];
+                    }
+                    i = end;
+                }
+                else if (c == '{' || c == '}')
+                {
+                    result += '[';
+                    result += c;
+                    result += ']';
+                }
+                else
+                {
+                    result += c;
+                }
+            }
+            return result;
+        }
+
+        // 与 pos 处 [ 配对的 ], 规则同 glob: 开头的 ] 与 !/^ 之后的 ] 属于集合本身
+        static size_t ClassEnd(std::string_view segment, size_t pos)
+        {
+            size_t i = pos + 1;
+            if (i < segment.size() && (segment[i] == '!' || segment[i] == '^'))
+            {
+                i++;
+            }
+            if (i < segment.size() && segment[i] == ']')
+            {
+                i++;
+            }
+            for (; i < segment.size(); i++)
+            {
+                if (segment[i] == '\\' && i + 1 < segment.size())
+                {
+                    i++;
+                    continue;
+                }
+                if (segment[i] == ']')
+                {
+                    return i;
+                }
+            }
+            return std::string_view::npos;
+        }
+
+        static bool MatchParts(const std::vector<PatternPtr> &parts, size_t i, const std::vector<std::string_view> &segs, size_t j)
+        {
+            if (i == parts.size())
+            {
+                return j == segs.size();
+            }
+            if (parts[i]->IsRecursive())
+            {
+                // 末尾的 ** 只匹配目录之内的内容, 至少再匹配一层 (foo/** 不匹配 foo 自身)
+                for (size_t k = i + 1 == parts.size() ? j + 1 : j; k <= segs.size(); k++)
+                {
+                    if (MatchParts(parts, i + 1, segs, k))
+                    {
+                        return true;
+                    }
+                }
+                return false;
+            }
+            return j < segs.size() && parts[i]->Match(segs[j]) && MatchParts(parts, i + 1, segs, j + 1);
+        }
+
+        // 1 为排除, 0 为被 ! 重新包含, -1 为本层没有规则命中
+        int Decide(std::string_view dir, std::string_view name, bool is_dir) const
+        {
+            if (rules.empty())
+            {
+                return -1;
+            }
+            // 只有 base 之下的条目受本层约束
+            std::string_view rel_dir = dir;
+            if (!base.empty())
+            {
+                if (dir.size() < base.size() || dir.substr(0, base.size()) != base || (dir.size() > base.size() && dir[base.size()] != '/'))
+                {
+                    return -1;
+                }
+                rel_dir = dir.substr(std::min<size_t>(dir.size(), base.size() + 1));
+            }
+            std::vector<std::string_view> segs;
+            bool split = false;
+            for (auto it = rules.rbegin(); it != rules.rend(); ++it)
+            {
+                const Rule &rule = *it;
+                if (rule.dir_only && !is_dir)
+                {
+                    continue;
+                }
+                bool hit = false;
+                if (!rule.anchored)
+                {
+                    hit = rule.parts.front()->Match(name);
+                }
+                else
+                {
+                    if (!split)
+                    {
+                        size_t start = 0;
+                        while (start < rel_dir.size())
+                        {
+                            size_t end = rel_dir.find('/', start);
+                            if (end == std::string_view::npos)
+                            {
+                                end = rel_dir.size();
+                            }
+                            segs.push_back(rel_dir.substr(start, end - start));
+                            start = end + 1;
+                        }
+                        segs.push_back(name);
+                        split = true;
+                    }
+                    hit = MatchParts(rule.parts, 0, segs, 0);
+                }
+                if (hit)
+                {
+                    return rule.negated ? 0 : 1;
+                }
+            }
+            return -1;
+        }
+    };
+
+    // 遍历到某个目录时生效的排除规则, 以及该目录相对遍历根的路径
+    struct IgnoreScope
+    {
+        std::shared_ptr<const IgnoreRules> rules;
+        std::string rel;
+        // 是否读取遍历中遇到的 .gitignore
+        bool read = false;
+
+        // root 为遍历根, read 为 true 时同时读取根目录下的 .gitignore
+        static IgnoreScope Root(std::shared_ptr<const IgnoreRules> rules, const fs::path &root, bool read)
+        {
+            IgnoreScope scope{std::move(rules), "", read};
+            scope.Load(root);
+            return scope;
+        }
+
+        bool Active() const
+        {
+            return rules || read;
+        }
+
+        bool Excludes(std::string_view name, bool is_dir) const
+        {
+            return rules && rules->IsIgnored(rel, name, is_dir);
+        }
+
+        // 进入名为 name 的子目录 dir_path
+        IgnoreScope Enter(const fs::path &dir_path, std::string_view name) const
+        {
+            IgnoreScope child{rules, rel.empty() ? std::string(name) : rel + "/" + std::string(name), read};
+            child.Load(dir_path);
+            return child;
+        }
+
+    private:
+        void Load(const fs::path &dir_path)
+        {
+            if (!read)
+            {
+                return;
+            }
+            auto frame = std::make_shared<IgnoreRules>(rules, rel);
+            if (frame->AddFile(dir_path / ".gitignore"))
+            {
+                rules = std::move(frame);
+            }
+        }
+    };
+}
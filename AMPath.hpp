@@ -1,22 +1,47 @@
 #pragma once
+#include "AMPathMatch.hpp"
+#include "AMIgnore.hpp"
+#include "AMSnapshot.hpp"
+#include "AMStatBatch.hpp"
+#include "AMDirEnum.hpp"
 #include "AMTools.hpp"
-#include <aclapi.h>
+#include "AMWorkPool.hpp"
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <ctime>
+#include <deque>
 #include <filesystem>
 #include <fmt/format.h>
 #include <functional>
+#include <future>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <regex>
-#include <sddl.h>
-#include <shlwapi.h>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
 #include <variant>
+#include <vector>
+#ifdef _WIN32
+#include <aclapi.h>
+#include <sddl.h>
+#include <shlwapi.h>
 #include <windows.h>
+#else
+#include <cerrno>
+#include <grp.h>
+#include <pwd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace AMPathTools
 {
@@ -120,6 +145,7 @@ namespace AMPathTools
         return (remaining == 0);
     }
 
+#ifdef _WIN32
     std::string AMstr(const std::wstring &wstr)
     {
         int codePage = GetACP();
@@ -172,6 +198,170 @@ namespace AMPathTools
         return result;
     }
 
+    std::string AMutf8(const std::string &str)
+    {
+        if (is_valid_utf8(str))
+        {
+            return str;
+        }
+        std::wstring wstr = AMPathTools::AMstr(str);
+        int len = WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), -1, nullptr, 0, nullptr, nullptr);
+        if (len <= 0)
+            return "";
+        std::string result(len - 1, 0);
+        WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), -1, &result[0], len, nullptr, nullptr);
+        return result;
+    }
+#else
+    // 非 Windows 平台的窄字符串即 UTF-8
+    std::string AMstr(const std::wstring &wstr)
+    {
+        return fs::path(wstr).string();
+    }
+
+    std::string AMstr(const wchar_t *wstr)
+    {
+        return fs::path(wstr).string();
+    }
+
+    std::wstring AMstr(const std::string &str)
+    {
+        return fs::path(str).wstring();
+    }
+
+    std::wstring AMstr(const char *str)
+    {
+        return fs::path(str).wstring();
+    }
+
+    std::string AMutf8(const std::string &str)
+    {
+        return str;
+    }
+#endif
+
+    // 匹配器只处理 UTF-8, Windows 下 path::string() 得到的是 ACP 编码
+    std::string u8name(const fs::path &path)
+    {
+#ifdef _WIN32
+        return path.filename().u8string();
+#else
+        return path.filename().string();
+#endif
+    }
+
+    // 属主标识 (Windows 为 SID 的字节, POSIX 为 uid) 到名字的缓存; 查询失败的结果同样缓存, 但有效期更短;
+    // 同一标识并发未命中时只有一个线程查询, 其余线程等待其结果
+    class OwnerCache
+    {
+    public:
+        OwnerCache(std::chrono::seconds ttl = std::chrono::seconds(600), std::chrono::seconds negative_ttl = std::chrono::seconds(30)) : ttl(ttl), negative_ttl(negative_ttl) {}
+
+        // resolve 形如 std::optional<std::string>(), 返回空表示查询失败
+        template <typename Resolve>
+        std::optional<std::string> Get(const std::string &key, Resolve &&resolve)
+        {
+            std::promise<std::optional<std::string>> promise;
+            std::shared_future<std::optional<std::string>> future;
+            uint64_t id = 0;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                auto it = entries.find(key);
+                if (it != entries.end() && std::chrono::steady_clock::now() < it->second.expires)
+                {
+                    hits++;
+                    future = it->second.value;
+                }
+                else
+                {
+                    misses++;
+                    id = ++next_id;
+                    future = promise.get_future().share();
+                    // 查询完成前不过期, 其他线程等待同一个结果
+                    entries[key] = {future, std::chrono::steady_clock::time_point::max(), id};
+                }
+            }
+            if (id == 0)
+            {
+                return future.get();
+            }
+
+            std::optional<std::string> name;
+            try
+            {
+                name = resolve();
+            }
+            catch (...)
+            {
+            }
+            promise.set_value(name);
+
+            std::lock_guard<std::mutex> lock(mtx);
+            auto it = entries.find(key);
+            if (it != entries.end() && it->second.id == id)
+            {
+                it->second.expires = std::chrono::steady_clock::now() + (name ? ttl : negative_ttl);
+            }
+            return name;
+        }
+
+        void SetTTL(std::chrono::seconds new_ttl, std::chrono::seconds new_negative_ttl)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            ttl = new_ttl;
+            negative_ttl = new_negative_ttl;
+        }
+
+        size_t Size() const
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            return entries.size();
+        }
+
+        uint64_t GetHits() const
+        {
+            return hits.load();
+        }
+
+        // 即实际查询的次数
+        uint64_t GetMisses() const
+        {
+            return misses.load();
+        }
+
+        void Clear()
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            entries.clear();
+            hits = 0;
+            misses = 0;
+        }
+
+    private:
+        struct Entry
+        {
+            std::shared_future<std::optional<std::string>> value;
+            std::chrono::steady_clock::time_point expires;
+            // 区分 Clear 之后重新插入的同名条目
+            uint64_t id = 0;
+        };
+
+        std::chrono::seconds ttl;
+        std::chrono::seconds negative_ttl;
+        mutable std::mutex mtx;
+        std::unordered_map<std::string, Entry> entries;
+        uint64_t next_id = 0;
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+    };
+
+    OwnerCache &GetOwnerCache()
+    {
+        static OwnerCache cache;
+        return cache;
+    }
+
+#ifdef _WIN32
     namespace WinAPI
     {
         uint64_t FileTimeToUnixTime(const FILETIME &ft)
@@ -196,25 +386,33 @@ namespace AMPathTools
                 NULL,
                 &pSD);
 
-            std::wstring owner = L"unknown";
-            if (dwRtnCode == ERROR_SUCCESS)
-            {
-                wchar_t szOwnerName[256];
-                wchar_t szDomainName[256];
-                DWORD dwNameLen = 256;
-                DWORD dwDomainLen = 256;
-                SID_NAME_USE eUse;
-
-                if (LookupAccountSidW(
-                        NULL,
-                        pSidOwner,
-                        szOwnerName,
-                        &dwNameLen,
-                        szDomainName,
-                        &dwDomainLen,
-                        &eUse))
-                {
-                    owner = szOwnerName;
+            std::string owner = "unknown";
+            if (dwRtnCode == ERROR_SUCCESS && pSidOwner && IsValidSid(pSidOwner))
+            {
+                // LookupAccountSidW 在域环境下可能需要毫秒级的网络往返, 按 SID 缓存
+                std::string key(reinterpret_cast<const char *>(pSidOwner), GetLengthSid(pSidOwner));
+                auto name = GetOwnerCache().Get(key, [pSidOwner]() -> std::optional<std::string>
+                                                {
+                                                    wchar_t szOwnerName[256];
+                                                    wchar_t szDomainName[256];
+                                                    DWORD dwNameLen = 256;
+                                                    DWORD dwDomainLen = 256;
+                                                    SID_NAME_USE eUse;
+                                                    if (!LookupAccountSidW(
+                                                            NULL,
+                                                            pSidOwner,
+                                                            szOwnerName,
+                                                            &dwNameLen,
+                                                            szDomainName,
+                                                            &dwDomainLen,
+                                                            &eUse))
+                                                    {
+                                                        return std::nullopt;
+                                                    }
+                                                    return AMPathTools::AMstr(std::wstring(szOwnerName)); });
+                if (name)
+                {
+                    owner = *name;
                 }
             }
 
@@ -223,7 +421,7 @@ namespace AMPathTools
                 LocalFree(pSD);
             }
 
-            return AMPathTools::AMstr(owner);
+            return owner;
         }
 
         std::pair<uint64_t, uint64_t> GetTime(const std::wstring &path)
@@ -262,46 +460,55 @@ namespace AMPathTools
             return false;
         }
     }
-
-    bool _match(const std::string &name, const std::string &pattern_f, const bool &use_regex)
+#else
+    namespace PosixAPI
     {
-        std::string pattern = pattern_f;
-        if (!use_regex || pattern.front() != '<')
-        {
-            pattern = std::regex_replace(pattern, std::regex("\\*"), std::string(exc1));
-            pattern = regex_escape(pattern);
-            pattern = std::regex_replace(pattern, std::regex(exc1), ".*");
-            std::wstring p_w = AMPathTools::AMstr(pattern);
-
-            std::wstring n_w = AMPathTools::AMstr(name);
-            try
-            {
-                return std::regex_search(n_w, std::wregex(p_w));
-            }
-            catch (std::exception e)
-            {
-                return false;
-            }
-        }
-        else
-        {
-            pattern = pattern.substr(1);
-            std::wregex pattern_f(AMPathTools::AMstr(pattern));
-            try
-            {
-                bool result = std::regex_search(AMPathTools::AMstr(name), pattern_f);
-                return result;
-            }
-            catch (const std::exception &e)
+        // getpwuid_r 可能经过 NSS 访问 LDAP 等远端服务, 按 uid 缓存
+        std::string GetFileOwner(uid_t uid)
+        {
+            std::string key = std::to_string(uid);
+            auto name = GetOwnerCache().Get(key, [uid]() -> std::optional<std::string>
+                                            {
+                                                struct passwd pwd;
+                                                struct passwd *result = nullptr;
+                                                std::vector<char> buffer(1024);
+                                                int rc = 0;
+                                                while ((rc = getpwuid_r(uid, &pwd, buffer.data(), buffer.size(), &result)) == ERANGE && buffer.size() < (1u << 20))
+                                                {
+                                                    buffer.resize(buffer.size() * 2);
+                                                }
+                                                if (rc != 0 || !result)
+                                                {
+                                                    return std::nullopt;
+                                                }
+                                                return std::string(result->pw_name); });
+            return name ? *name : key;
+        }
+
+        std::string ModeString(mode_t mode)
+        {
+            const char *flags = "rwxrwxrwx";
+            std::string out(9, '-');
+            for (int i = 0; i < 9; i++)
             {
-                return false;
+                if (mode & (0400 >> i))
+                {
+                    out[i] = flags[i];
+                }
             }
+            return out;
         }
     }
+#endif
+
+    // 与 find 共用编译好的匹配器, 通配语法见 CompiledPattern
+    bool _match(const std::string &name, const std::string &pattern_f, const bool &use_regex)
+    {
+        return AMPathTools::GetCompiledPattern(AMPathTools::AMutf8(pattern_f), use_regex)->Match(AMPathTools::AMutf8(name));
+    }
 
     std::variant<bool, std::string> isPatternsValid(const std::vector<std::string> &patterns)
     {
-        std::regex pattern_f;
         for (auto pattern : patterns)
         {
             if (pattern.empty())
@@ -317,15 +524,10 @@ namespace AMPathTools
                 return "Recive a single <";
             };
 
-            try
-            {
-                pattern_f = std::regex(pattern.substr(1));
-                std::regex_search("abc", pattern_f);
-            }
-            catch (std::exception e)
+            PatternPtr compiled = GetCompiledPattern(AMutf8(pattern), true);
+            if (!compiled->IsValid())
             {
-                std::string msg = fmt::format("Pattern \"{}\" parsing failed: {}", pattern, e.what());
-                return msg;
+                return compiled->GetError();
             }
         }
         return true;
@@ -339,6 +541,15 @@ namespace AMPath
     constexpr char *AMERROR = "ERROR";
     constexpr char *AMWARNING = "WARNING";
 
+    // stat 需要计算的字段, 按位组合; 类型总会计算, 未请求的字段保持默认值
+    // STAT_NAME: name / path / dir, STAT_SIZE: size, STAT_TIMES: atime / mtime, STAT_OWNER: uname, STAT_MODE: mode_int / mode_str
+    constexpr uint32_t STAT_NAME = 1u << 0;
+    constexpr uint32_t STAT_SIZE = 1u << 1;
+    constexpr uint32_t STAT_TIMES = 1u << 2;
+    constexpr uint32_t STAT_OWNER = 1u << 3;
+    constexpr uint32_t STAT_MODE = 1u << 4;
+    constexpr uint32_t STAT_ALL = STAT_NAME | STAT_SIZE | STAT_TIMES | STAT_OWNER | STAT_MODE;
+
     struct PathInfo
     {
     public:
@@ -471,7 +682,8 @@ namespace AMPath
 
     bool is_absolute(const std::string &path)
     {
-        std::regex merged_regex("^(?:[A-Za-z]:[/\\\\]?|/|\\\\\\\\|~[\\\\/])");
+        // stat 对每个条目都会经过这里, 正则只编译一次
+        static const std::regex merged_regex("^(?:[A-Za-z]:[/\\\\]?|/|\\\\\\\\|~[\\\\/])");
         return std::regex_search(path, merged_regex);
     }
 
@@ -529,9 +741,21 @@ namespace AMPath
 
     std::string HomePath()
     {
-        return std::getenv("HOMEPROFILE");
+#ifdef _WIN32
+        const char *home = std::getenv("HOMEPROFILE");
+#else
+        const char *home = std::getenv("HOME");
+#endif
+        return home ? home : "";
     }
 
+    // find 拼接根目录时使用的分隔符
+#ifdef _WIN32
+    constexpr const char *PreferredSep = "\\";
+#else
+    constexpr const char *PreferredSep = "/";
+#endif
+
     std::string ShapePath(std::string path, std::string sep = "")
     {
         path = AMPath::Strip(path);
@@ -543,7 +767,7 @@ namespace AMPath
         }
         std::string head = path.substr(0, 2);
 
-        std::regex slash_pt("[\\\\/]+");
+        static const std::regex slash_pt("[\\\\/]+");
         path = head + std::regex_replace(path.substr(2), slash_pt, sep);
         return path;
     }
@@ -563,6 +787,12 @@ namespace AMPath
         {
             path = path.substr(2);
         }
+        else if (head[0] == '/')
+        {
+            // POSIX 绝对路径保留根目录
+            head = "/";
+            path = path.substr(1);
+        }
         else
         {
             head.clear();
@@ -603,7 +833,8 @@ namespace AMPath
             return {path};
         }
         std::vector<std::string> parts{};
-        std::string tmp_str = "";
+        // POSIX 绝对路径保留根目录
+        std::string tmp_str = path[0] == '/' && path[1] != '/' && path[1] != '\\' ? "/" : "";
         bool in_brackets = false;
         std::string bracket_str = "";
         for (auto &sig : path)
@@ -632,7 +863,7 @@ namespace AMPath
                 }
                 else if (sig == '/' || sig == '\\')
                 {
-                    if (!tmp_str.empty())
+                    if (!tmp_str.empty() && tmp_str != "/")
                     {
                         parts.push_back(tmp_str);
                         tmp_str.clear();
@@ -825,473 +1056,2126 @@ namespace AMPath
         }
     }
 
-    std::variant<PathInfo, std::pair<std::string, std::exception>> stat(const std::string &path, bool trace_link = false)
+    // 遍历与 stat / listdir 主动发起的文件系统调用计数, 用于核对优化效果;
+    // dir_opens 为目录枚举次数, stats 为元数据调用次数, probes 为字面量段的存在性探测次数
+    struct IOStats
     {
-        PathInfo info;
-        fs::path p(path);
-        std::wstring wpath = AMPathTools::AMstr(path);
-        info.name = p.filename().string();
-        info.path = realpath(path);
-        info.dir = p.parent_path().string();
-        fs::file_status status;
-        try
+        uint64_t dir_opens = 0;
+        uint64_t entries = 0;
+        uint64_t stats = 0;
+        uint64_t probes = 0;
+    };
+
+    class IOCounters
+    {
+    public:
+        std::atomic<uint64_t> dir_opens = 0;
+        std::atomic<uint64_t> entries = 0;
+        std::atomic<uint64_t> stats = 0;
+        std::atomic<uint64_t> probes = 0;
+
+        IOStats Snapshot() const
         {
-            if (trace_link)
-            {
-                status = fs::status(p);
-            }
-            else
-            {
-                status = fs::symlink_status(p);
-            }
+            return {dir_opens.load(), entries.load(), stats.load(), probes.load()};
         }
-        catch (const std::exception &e)
+
+        void Reset()
         {
-            return std::make_pair("Stat error: " + path, e);
+            dir_opens = 0;
+            entries = 0;
+            stats = 0;
+            probes = 0;
         }
+    };
+
+    IOCounters &GetIOCounters()
+    {
+        static IOCounters counters;
+        return counters;
+    }
 
-        switch (status.type())
+    // 一次元数据调用的结果转为 PathInfo; 属主在 Windows 上仍需按路径查询 SID
+    void fill_path_info(const AMPathTools::EntryStat &st, [[maybe_unused]] const fs::path &path, uint32_t fields, PathInfo &info)
+    {
+        switch (st.type)
         {
-        case fs::file_type::directory:
+        case AMPathTools::EntryType::Directory:
             info.type = AMPathTools::ENUMS::PathType::DIR;
             break;
-        case fs::file_type::symlink:
-            info.type = AMPathTools::ENUMS::PathType::SYMLINK;
-            break;
-        case fs::file_type::regular:
+        case AMPathTools::EntryType::File:
             info.type = AMPathTools::ENUMS::PathType::FILE;
             break;
-        case fs::file_type::block:
-            info.type = AMPathTools::ENUMS::PathType::BlockDevice;
-            break;
-        case fs::file_type::character:
-            info.type = AMPathTools::ENUMS::PathType::CharacterDevice;
-            break;
-        case fs::file_type::fifo:
-            info.type = AMPathTools::ENUMS::PathType::FIFO;
-            break;
-        case fs::file_type::socket:
-            info.type = AMPathTools::ENUMS::PathType::Socket;
+        case AMPathTools::EntryType::Symlink:
+            info.type = AMPathTools::ENUMS::PathType::SYMLINK;
             break;
-        case fs::file_type::unknown:
-            info.type = AMPathTools::ENUMS::PathType::Unknown;
+#ifndef _WIN32
+        case AMPathTools::EntryType::Other:
+            info.type = S_ISBLK(st.mode) ? AMPathTools::ENUMS::PathType::BlockDevice : S_ISCHR(st.mode) ? AMPathTools::ENUMS::PathType::CharacterDevice
+                                                                                   : S_ISFIFO(st.mode)  ? AMPathTools::ENUMS::PathType::FIFO
+                                                                                   : S_ISSOCK(st.mode)  ? AMPathTools::ENUMS::PathType::Socket
+                                                                                                        : AMPathTools::ENUMS::PathType::Unknown;
             break;
+#endif
         default:
             info.type = AMPathTools::ENUMS::PathType::Unknown;
             break;
         }
-
-        if (info.type == AMPathTools::ENUMS::PathType::FILE)
+        if ((fields & STAT_SIZE) && info.type == AMPathTools::ENUMS::PathType::FILE)
         {
-            try
-            {
-                info.size = fs::file_size(p);
-            }
-            catch (const std::exception)
-            {
-            }
+            info.size = st.size;
         }
-
-        if (AMPathTools::WinAPI::is_readonly(AMPathTools::AMstr(path)))
+        if (fields & STAT_TIMES)
         {
-            info.mode_int = 0333;
-            info.mode_str = "r-xr-xr-x";
+            info.atime = st.atime;
+            info.mtime = st.mtime;
         }
-        else
+#ifdef _WIN32
+        if (fields & STAT_MODE)
         {
-            info.mode_int = 0666;
-            info.mode_str = "rwxrwxrwx";
+            info.mode_int = st.readonly ? 0333 : 0666;
+            info.mode_str = st.readonly ? "r-xr-xr-x" : "rwxrwxrwx";
         }
-
-        auto [atime, mtime] = AMPathTools::WinAPI::GetTime(wpath);
-        info.atime = atime;
-        info.mtime = mtime;
-        info.uname = AMPathTools::WinAPI::GetFileOwner(wpath);
-        return info;
-    }
-
-    std::vector<PathInfo> listdir(const std::string &path)
-    {
-        std::vector<PathInfo> result = {};
-        fs::path p(path);
-        if (!fs::exists(p))
+        if (fields & STAT_OWNER)
         {
-            return result;
+            info.uname = AMPathTools::WinAPI::GetFileOwner(path.wstring());
         }
-        if (!fs::is_directory(p))
+#else
+        if (fields & STAT_MODE)
         {
-            return result;
+            info.mode_int = st.mode & 0777;
+            info.mode_str = AMPathTools::PosixAPI::ModeString(st.mode);
         }
-        std::variant<PathInfo, std::pair<std::string, std::exception>> sr;
-        for (const auto &entry : fs::directory_iterator(p))
+        if (fields & STAT_OWNER)
         {
-            sr = stat(entry.path().string(), false);
-            if (std::holds_alternative<PathInfo>(sr))
-            {
-                result.push_back(std::get<PathInfo>(sr));
-            }
+            info.uname = AMPathTools::PosixAPI::GetFileOwner(st.uid);
         }
-        return result;
+#endif
     }
 
-    void _walk(std::string path, std::vector<PathInfo> &result, bool ignore_sepcial_file, bool trace_link)
+    // 由目录中条目的名字与已取得的元数据 (见 StatBatch) 构造 PathInfo, 不再发起调用
+    void entry_path_info(const fs::path &dir_path, std::string_view name, const AMPathTools::EntryStat &st, uint32_t fields, PathInfo &info)
     {
-        fs::path p(path);
-        fs::file_status status;
-        if (!fs::exists(p))
+        fs::path p = dir_path / AMPathTools::path_from_utf8(name);
+        if (fields & STAT_NAME)
         {
-            return;
-        }
-        auto sr = stat(path, trace_link);
-        if (std::holds_alternative<PathInfo>(sr))
-        {
-            result.push_back(std::get<PathInfo>(sr));
+            info.name = p.filename().string();
+            info.path = realpath(p.string());
+            info.dir = p.parent_path().string();
         }
+        fill_path_info(st, p, fields, info);
     }
 
-    std::vector<PathInfo> walk(const std::string &path, bool ignore_sepcial_file, bool trace_link)
+    // fields 为 STAT_* 的组合, 只计算请求的字段
+    std::variant<PathInfo, std::pair<std::string, std::exception>> stat(const std::string &path, bool trace_link = false, uint32_t fields = STAT_ALL)
     {
-        std::vector<PathInfo> results = {};
-
-        _walk(path, results, ignore_sepcial_file, trace_link);
-
-        return results;
+        PathInfo info;
+        fs::path p(path);
+        if (fields & STAT_NAME)
+        {
+            info.name = p.filename().string();
+            info.path = realpath(path);
+            info.dir = p.parent_path().string();
+        }
+        AMPathTools::EntryStat st;
+        std::error_code ec;
+        GetIOCounters().stats.fetch_add(1, std::memory_order_relaxed);
+        if (!AMPathTools::stat_basic(p, st, trace_link, ec))
+        {
+            // 不存在的路径返回类型为 Unknown 的结果
+            if (ec == std::errc::no_such_file_or_directory || ec == std::errc::not_a_directory)
+            {
+                info.type = AMPathTools::ENUMS::PathType::Unknown;
+                return info;
+            }
+            return std::make_pair("Stat error: " + path, std::runtime_error(ec.message()));
+        }
+        fill_path_info(st, p, fields, info);
+        return info;
     }
 
-    void _getsize(const std::string &path, uint64_t &result, bool trace_link)
+    // 逐个产出目录中条目的 PathInfo, 同一对象在两次调用之间会被重新填充; 返回产出的条目数;
+    // 取不到元数据的条目不产出, 通过 callback 以 StatFailed 报告
+    size_t listdir_each(const std::string &path, const std::function<void(PathInfo &)> &sink, uint32_t fields = STAT_ALL, CB callback = nullptr)
     {
         fs::path p(path);
         if (!fs::exists(p))
         {
-            return;
+            return 0;
         }
-        if (fs::is_directory(p))
+        if (!fs::is_directory(p))
         {
-            for (const auto &entry : fs::directory_iterator(p))
-            {
-                _getsize(entry.path().string(), result, trace_link);
-            }
+            return 0;
         }
-        else if (fs::is_symlink(p))
+        IOCounters &counters = GetIOCounters();
+        counters.dir_opens.fetch_add(1, std::memory_order_relaxed);
+        AMPathTools::DirEnumerator dir(p);
+        AMPathTools::StatBatch stats(dir, false);
+        AMPathTools::DirEntry entry;
+        while (dir.Next(entry))
         {
-            if (trace_link)
-            {
-                _getsize(fs::read_symlink(p).string(), result, trace_link);
-            }
+            stats.Add(entry);
         }
-        else if (fs::is_regular_file(p))
+        stats.Run();
+        size_t count = 0;
+        PathInfo info;
+        for (size_t i = 0; i < stats.Size(); i++)
         {
-            result += fs::file_size(p);
-        }
+            if (!stats.Ok(i))
+            {
+                if (callback)
+                {
+                    (*callback)((p / AMPathTools::path_from_utf8(stats.Name(i))).string(), "StatFailed", stats.Error(i).message());
+                }
+                continue;
+            }
+            info = PathInfo();
+            entry_path_info(p, stats.Name(i), stats.Stat(i), fields, info);
+            sink(info);
+            count++;
+        }
+        counters.entries.fetch_add(count, std::memory_order_relaxed);
+        counters.stats.fetch_add(dir.GetStatCalls(), std::memory_order_relaxed);
+        return count;
     }
 
-    uint64_t getsize(const std::string &path, bool trace_link = false)
+    std::vector<PathInfo> listdir(const std::string &path, uint32_t fields = STAT_ALL, CB callback = nullptr)
     {
-        uint64_t result = 0;
-        _getsize(path, result, trace_link);
+        std::vector<PathInfo> result = {};
+        listdir_each(
+            path, [&result](PathInfo &info)
+            { result.push_back(std::move(info)); },
+            fields, callback);
         return result;
     }
 
-    std::tuple<std::vector<std::string>, std::string, bool> preprocess(std::string path, bool use_regex)
+    enum class WalkOrder
     {
+        // 目录先于其内容产出
+        TopDown = 0,
+        // 目录在其全部内容之后产出
+        BottomUp = 1
+    };
 
-        VStrip(path);
+    enum class WalkChangeType
+    {
+        Added = 0,
+        Removed = 1,
+        Modified = 2
+    };
 
-        std::string sep = GetPathSep(path);
+    struct WalkChange
+    {
+        WalkChangeType kind = WalkChangeType::Added;
+        std::string path;
+        AMPathTools::ENUMS::PathType type = AMPathTools::ENUMS::PathType::FILE;
+    };
 
-        if (!is_absolute(path))
-        {
-            path = HomePath() + sep + path;
-        }
+    struct WalkOptions
+    {
+        WalkOrder order = WalkOrder::TopDown;
+        // 跟随指向目录的链接, 同一目录 (设备, inode) 只进入一次
+        bool trace_link = false;
+        // path 自身是链接时是否跟随 (类似 find -H), 与 trace_link 无关; 为 false 时链接作为单个条目产出
+        bool follow_root = true;
+        // 跳过块设备 / 字符设备 / FIFO / socket 等特殊文件
+        bool ignore_sepcial_file = false;
+        // 0 为硬件线程数
+        size_t threads = 1;
+        // 每批最多的条目数
+        size_t batch = 256;
+        // 对每个目录调用, 返回 true 时不进入该目录 (目录自身仍会产出)
+        std::function<bool(const PathInfo &dir)> prune;
+        // 快照文件 (UTF-8); 非空时读取上一次的快照, 修改时间未变的目录直接取自快照而不枚举, 完整遍历后写回;
+        // 目录的修改时间只反映子项的增删与改名, 未变目录中文件内容的改动要等该目录变化后才会体现
+        std::string snapshot;
+        // 与快照相比的变化, 只在成功读取了快照时报告; 与 sink 一样加锁调用
+        std::function<void(const WalkChange &change)> on_change;
+        // 需要计算的 STAT_* 字段; 遍历要用到路径, STAT_NAME 总会计算
+        uint32_t fields = STAT_ALL;
+        // gitignore 语法的排除规则, 相对 path; 被排除的条目不产出, 被排除的目录不会被打开
+        std::shared_ptr<const AMPathTools::IgnoreRules> exclude;
+        // 同时读取遍历中遇到的 .gitignore
+        bool read_gitignore = false;
+        // Linux 上用 io_uring 批量 statx (见 StatBatch); 冷缓存或网络文件系统上可能更快, 缓存命中时通常更慢
+        bool io_uring = false;
+    };
 
-        std::vector<std::string> ori_parts;
-        if (use_regex)
+    bool is_special_type(AMPathTools::ENUMS::PathType type)
+    {
+        return type != AMPathTools::ENUMS::PathType::DIR && type != AMPathTools::ENUMS::PathType::FILE && type != AMPathTools::ENUMS::PathType::SYMLINK;
+    }
+
+    // 递归遍历并分批产出 PathInfo, 包括 path 自身; sink 返回 false 时停止, 此时返回 false;
+    // 多线程时 sink 与 prune 会被加锁串行调用, 批与批之间的顺序只保证 order 约定的父子先后
+    bool walk_each(const std::string &path, const std::function<bool(std::vector<PathInfo> &)> &sink, const WalkOptions &options = {}, CB callback = nullptr)
+    {
+        uint32_t fields = options.fields | STAT_NAME;
+        auto root_sr = stat(path, options.follow_root, fields);
+        if (!std::holds_alternative<PathInfo>(root_sr))
         {
-            ori_parts = AMPath::resplit(path, '<', '>', "<");
+            return true;
         }
-        else
+        PathInfo root_info = std::get<PathInfo>(root_sr);
+        if (root_info.type != AMPathTools::ENUMS::PathType::DIR)
         {
-            ori_parts = AMPath::split(path);
+            if (options.ignore_sepcial_file && is_special_type(root_info.type))
+            {
+                return true;
+            }
+            std::vector<PathInfo> single = {root_info};
+            return sink(single);
         }
 
-        std::vector<std::string> path_parts = {};
+        // 自底向上时每个目录记录未完成的子目录数, 归零时产出自身并通知上层
+        struct Node
+        {
+            PathInfo info;
+            std::atomic<size_t> pending = 1;
+            std::shared_ptr<Node> parent;
+            AMPathTools::IgnoreScope scope;
+            // 上一级与快照比较时被报告为新增, 其内容也都是新增
+            bool is_new = false;
+        };
 
-        bool is2star = false;
-        bool is_recursive = false;
-        for (int i = 0; i < ori_parts.size(); i++)
+        size_t batch_size = std::max<size_t>(1, options.batch);
+        bool bottom_up = options.order == WalkOrder::BottomUp;
+        std::atomic<bool> stop = false;
+        std::mutex sink_mutex;
+        std::mutex seen_mutex;
+        AMPathTools::FileIdSet seen;
+        CB locked = nullptr;
+        if (callback)
+        {
+            locked = std::make_shared<std::function<void(std::string, std::string, std::string)>>(
+                [&](std::string cur_path, std::string error, std::string msg)
+                {
+                    std::lock_guard<std::mutex> lock(sink_mutex);
+                    (*callback)(cur_path, error, msg);
+                });
+        }
+        auto flush = [&](std::vector<PathInfo> &batch)
         {
-            auto part = ori_parts[i];
-            if (part == "**")
+            if (batch.empty() || stop)
             {
-                is_recursive = true;
-                if (is2star)
-                {
-                    continue;
-                }
-                else
-                {
-                    is2star = true;
-                    path_parts.push_back(part);
-                }
+                batch.clear();
+                return;
             }
-            else
+            std::lock_guard<std::mutex> lock(sink_mutex);
+            if (!stop && !sink(batch))
             {
-                is2star = false;
-                path_parts.push_back(part);
+                stop = true;
             }
-        }
-
-        std::vector<std::string> match_parts;
-        std::vector<std::string> root_parts;
-
-        int num_i = 0;
-        bool is_match;
-        bool is_end = false;
-        for (int i = 0; i < path_parts.size(); i++)
+            batch.clear();
+        };
+        auto emit = [&](std::vector<PathInfo> &batch, PathInfo info)
         {
-            auto part = path_parts[i];
-            if (is_end)
+            batch.push_back(std::move(info));
+            if (batch.size() >= batch_size)
             {
-                match_parts.push_back(part);
-                continue;
+                flush(batch);
             }
-
-            if (use_regex)
+        };
+        auto pruned = [&](const PathInfo &info)
+        {
+            if (!options.prune)
             {
-                is_match = part[0] == '<' || part.find("*") != std::string::npos;
+                return false;
             }
-            else
+            std::lock_guard<std::mutex> lock(sink_mutex);
+            return options.prune(info);
+        };
+        // 子目录全部完成后沿父链向上产出
+        auto complete = [&](std::shared_ptr<Node> node, std::vector<PathInfo> &batch)
+        {
+            while (node && --node->pending == 0)
             {
-                is_match = part.find("*") != std::string::npos;
+                emit(batch, std::move(node->info));
+                flush(batch);
+                node = node->parent;
             }
+        };
 
-            if (is_match)
+        // 快照: baseline 为上一次的结果, records 收集本次每个目录的内容
+        bool track = !options.snapshot.empty();
+        // 快照只保存请求过的字段, 字段不同的快照不能复用
+        uint32_t snapshot_flags = (options.trace_link ? 1u : 0u) | (options.ignore_sepcial_file ? 2u : 0u) | (fields << 8);
+        AMPathTools::WalkSnapshot baseline;
+        if (track)
+        {
+            baseline.Load(options.snapshot, snapshot_flags);
+        }
+        auto entry_info = [](const fs::path &dir_path, std::string_view name, const AMPathTools::SnapshotEntryRecord &record, const AMPathTools::WalkSnapshot &snap)
+        {
+            fs::path p = dir_path / AMPathTools::path_from_utf8(name);
+            PathInfo info;
+            // dir_path 已是规范路径, 直接拼接即可, 不再经过 realpath
+            info.name = p.filename().string();
+            info.path = p.string();
+            info.dir = p.parent_path().string();
+            info.uname = std::string(snap.Str(record.owner));
+            info.size = record.size;
+            info.atime = record.atime;
+            info.mtime = record.mtime;
+            info.type = static_cast<AMPathTools::ENUMS::PathType>(record.type);
+            info.mode_int = record.mode;
+            info.mode_str = std::string(snap.Str(record.mode_str));
+            return info;
+        };
+        auto report = [&](std::vector<WalkChange> &changes)
+        {
+            if (changes.empty() || !options.on_change)
             {
-                if (use_regex)
-                {
-                    match_parts.push_back(part.substr(1, part.size() - 1));
-                }
-                else
-                {
-                    match_parts.push_back(part);
-                }
-                is_end = true;
+                return;
             }
-            else
+            std::lock_guard<std::mutex> lock(sink_mutex);
+            for (auto &change : changes)
             {
-                root_parts.push_back(part);
+                options.on_change(change);
             }
-        }
-
-        return std::make_tuple(match_parts, AMPath::realpath(AMPath::join(root_parts), false, "\\"), is_recursive);
-    }
-
-    void search(std::vector<std::string> &results, fs::path root, std::string name, std::vector<std::string> remains, AMPathTools::ENUMS::SearchType type, bool use_regex, bool silence, CB callback)
-    {
-        if (!remains.empty())
+            changes.clear();
+        };
+        // 快照中已不存在的目录, 其下的内容一并报告为删除
+        std::function<void(const fs::path &, const std::string &, const AMPathTools::IgnoreScope &, std::vector<WalkChange> &)> removed_subtree;
+        removed_subtree = [&](const fs::path &dir_path, const std::string &key, const AMPathTools::IgnoreScope &scope, std::vector<WalkChange> &changes)
         {
-            if (!fs::is_directory(root))
+            const AMPathTools::SnapshotDirRecord *record = baseline.Find(key);
+            if (!record)
             {
                 return;
             }
-            try
+            const AMPathTools::SnapshotEntryRecord *entries = baseline.Entries(*record);
+            for (uint64_t i = 0; i < record->count; i++)
             {
-                fs::path cur_path;
-                std::string cur_name;
-                bool is_dir;
-                bool is_match;
-                bool next_match;
-                for (auto &entry : fs::directory_iterator(root))
+                std::string_view name = baseline.Str(entries[i].name);
+                bool is_dir = entries[i].type == static_cast<int32_t>(AMPathTools::ENUMS::PathType::DIR);
+                if (scope.Excludes(name, is_dir))
                 {
-                    cur_name = entry.path().filename().string();
-                    cur_path = AMPath::join(root, cur_name);
-                    is_dir = fs::is_directory(cur_path);
-                    is_match = AMPathTools::_match(cur_name, name, use_regex);
-
-                    if (name == "**")
+                    continue;
+                }
+                PathInfo info = entry_info(dir_path, name, entries[i], baseline);
+                changes.push_back({WalkChangeType::Removed, info.path, info.type});
+                if (is_dir)
+                {
+                    removed_subtree(fs::path(info.path), info.path, scope.Active() ? scope.Enter(fs::path(info.path), name) : AMPathTools::IgnoreScope{}, changes);
+                }
+            }
+        };
+        // names 与 listing 一一对应且按名字排序, 与快照中同样有序的条目归并比较; 被排除的条目不参与比较;
+        // record 为空表示新目录, 全部报告为新增; added 标记报告为新增的条目
+        auto diff = [&](const AMPathTools::SnapshotDirRecord *record, const fs::path &dir_path, const std::vector<std::string> &names, const std::vector<PathInfo> &listing, const AMPathTools::IgnoreScope &scope, std::vector<WalkChange> &changes, std::vector<char> &added)
+        {
+            added.assign(names.size(), 0);
+            const AMPathTools::SnapshotEntryRecord *entries = record ? baseline.Entries(*record) : nullptr;
+            uint64_t count = record ? record->count : 0;
+            size_t i = 0;
+            uint64_t j = 0;
+            while (i < names.size() || j < count)
+            {
+                int order = i == names.size() ? 1 : j == count ? -1
+                                                               : names[i].compare(baseline.Str(entries[j].name));
+                if (order < 0)
+                {
+                    if (!scope.Excludes(names[i], listing[i].type == AMPathTools::ENUMS::PathType::DIR))
+                    {
+                        changes.push_back({WalkChangeType::Added, listing[i].path, listing[i].type});
+                        added[i] = 1;
+                    }
+                    i++;
+                }
+                else if (order > 0)
+                {
+                    std::string_view name = baseline.Str(entries[j].name);
+                    bool is_dir = entries[j].type == static_cast<int32_t>(AMPathTools::ENUMS::PathType::DIR);
+                    if (!scope.Excludes(name, is_dir))
                     {
-                        next_match = AMPathTools::_match(cur_name, remains.front(), use_regex);
+                        PathInfo old = entry_info(dir_path, name, entries[j], baseline);
+                        changes.push_back({WalkChangeType::Removed, old.path, old.type});
                         if (is_dir)
                         {
-                            search(results, cur_path, name, remains, type, use_regex, silence, callback);
-                            if (next_match)
-                            {
-                                auto new_name = remains.front();
-                                auto new_remains = remains;
-                                new_remains.erase(new_remains.begin());
-                                search(results, cur_path, new_name, new_remains, type, use_regex, silence, callback);
-                            }
-                        }
-                        else
-                        {
-                            if (next_match)
-                            {
-                                results.push_back(cur_path.string());
-                            }
+                            removed_subtree(fs::path(old.path), old.path, scope.Active() ? scope.Enter(fs::path(old.path), name) : AMPathTools::IgnoreScope{}, changes);
                         }
-                        continue;
-                    }
-
-                    search(results, cur_path, name, remains, type, use_regex, silence, callback);
-                    if (is_match)
-                    {
-                        auto new_name = remains.front();
-                        auto new_remains = remains;
-                        new_remains.erase(new_remains.begin());
-                        search(results, cur_path, new_name, new_remains, type, use_regex, silence, callback);
                     }
-                    continue;
+                    j++;
                 }
-
-                if (is_match && is_dir)
+                else if (scope.Excludes(names[i], listing[i].type == AMPathTools::ENUMS::PathType::DIR) && scope.Excludes(names[i], entries[j].type == static_cast<int32_t>(AMPathTools::ENUMS::PathType::DIR)))
                 {
-                    std::string new_name = remains[0];
-                    auto new_remains = remains;
-                    new_remains.erase(new_remains.begin());
-                    search(results, cur_path, new_name, new_remains, type, use_regex, silence, callback);
+                    i++;
+                    j++;
                 }
-            }
-            catch (const std::exception e)
-            {
-                if (!silence && callback)
+                else
                 {
-                    (*callback)(root.string(), "IterdirFailed", e.what());
+                    const PathInfo &cur = listing[i];
+                    const AMPathTools::SnapshotEntryRecord &old = entries[j];
+                    // 目录的变化体现在其内容上, 这里只比较类型
+                    bool modified = static_cast<int32_t>(cur.type) != old.type || (cur.type != AMPathTools::ENUMS::PathType::DIR && (cur.size != old.size || cur.mtime != old.mtime));
+                    if (modified)
+                    {
+                        changes.push_back({WalkChangeType::Modified, cur.path, cur.type});
+                    }
+                    i++;
+                    j++;
                 }
             }
-        }
-        else
+        };
+
+        AMPathTools::WorkPool pool(options.threads);
+        std::vector<std::vector<AMPathTools::SnapshotDir>> records(pool.Size());
+        std::function<void(size_t, std::shared_ptr<Node>)> scan;
+        scan = [&](size_t worker, std::shared_ptr<Node> node)
         {
-            if (!fs::is_directory(root))
+            if (stop)
+            {
+                return;
+            }
+            std::vector<PathInfo> batch;
+            std::vector<std::shared_ptr<Node>> children;
+            fs::path dir_path(node->info.path);
+            if (options.trace_link)
             {
-                if (type != AMPathTools::ENUMS::SearchType::Directory && AMPathTools::_match(root.filename().string(), name, use_regex))
+                AMPathTools::FileId id;
+                if (AMPathTools::get_dir_id(dir_path, id))
                 {
-                    results.push_back(root.string());
+                    std::lock_guard<std::mutex> lock(seen_mutex);
+                    if (!seen.Insert(id))
+                    {
+                        if (bottom_up)
+                        {
+                            complete(node, batch);
+                        }
+                        return;
+                    }
                 }
-                return;
             }
 
-            if (name == "**")
+            uint64_t dir_mtime = 0;
+            bool has_mtime = track && AMPathTools::get_dir_mtime(dir_path, dir_mtime);
+            const AMPathTools::SnapshotDirRecord *record = track ? baseline.Find(node->info.path) : nullptr;
+            bool served = has_mtime && record && record->mtime == dir_mtime;
+            bool complete_listing = true;
+            std::vector<std::string> names;
+            std::vector<PathInfo> listing;
+            std::vector<char> added;
+            if (served)
             {
-                fs::path cur_path;
-                std::string cur_name;
-                bool is_dir;
-                for (auto &entry : fs::directory_iterator(root))
+                const AMPathTools::SnapshotEntryRecord *entries = baseline.Entries(*record);
+                for (uint64_t i = 0; i < record->count; i++)
                 {
-                    cur_name = entry.path().filename().string();
-                    cur_path = AMPath::join(root, cur_name);
-                    is_dir = fs::is_directory(cur_path);
-                    if (!is_dir)
+                    std::string_view name = baseline.Str(entries[i].name);
+                    PathInfo info = entry_info(dir_path, name, entries[i], baseline);
+                    // 子目录自身的属性可能已变, 重新 stat 一次
+                    if (info.type == AMPathTools::ENUMS::PathType::DIR && !node->scope.Excludes(name, true))
                     {
-                        if (type != AMPathTools::ENUMS::SearchType::Directory)
+                        auto sr = stat((dir_path / AMPathTools::path_from_utf8(name)).string(), options.trace_link, fields);
+                        if (std::holds_alternative<PathInfo>(sr))
                         {
-                            results.push_back(cur_path.string());
+                            info = std::get<PathInfo>(sr);
                         }
+                    }
+                    names.emplace_back(name);
+                    listing.push_back(std::move(info));
+                }
+            }
+            else
+            {
+                GetIOCounters().dir_opens.fetch_add(1, std::memory_order_relaxed);
+                AMPathTools::DirEnumerator dir(dir_path);
+                if (!dir.IsOpen() && locked)
+                {
+                    (*locked)(node->info.path, "IterdirFailed", dir.GetError().message());
+                }
+                // 多线程遍历时各目录已经并行, 批量 stat 不再另开线程池
+                AMPathTools::StatBatch stats(dir, options.trace_link, pool.Size() == 1 ? 0 : 1, options.io_uring);
+                AMPathTools::DirEntry entry;
+                while (!stop && dir.Next(entry))
+                {
+                    // 不记录快照时, 类型已知的条目在 stat 之前就排除; 记录快照时保留完整的目录内容, 产出时再排除
+                    if (!track && (entry.type == AMPathTools::EntryType::File || entry.type == AMPathTools::EntryType::Directory || (entry.type == AMPathTools::EntryType::Symlink && !options.trace_link)) && node->scope.Excludes(entry.name, entry.type == AMPathTools::EntryType::Directory))
+                    {
                         continue;
                     }
-                    if (fs::is_empty(cur_path))
+                    stats.Add(entry);
+                }
+                if (!stop)
+                {
+                    stats.Run();
+                }
+                bool stat_failed = false;
+                for (size_t i = 0; i < stats.Size() && !stop; i++)
+                {
+                    if (!stats.Ok(i))
                     {
-                        if (type != AMPathTools::ENUMS::SearchType::File)
+                        // 失效的链接已在 StatBatch 中按链接自身取得, 这里只剩真正的失败 (被删除, 无权限等)
+                        stat_failed = true;
+                        if (locked)
                         {
-                            results.push_back(cur_path.string());
+                            (*locked)((dir_path / AMPathTools::path_from_utf8(stats.Name(i))).string(), "StatFailed", stats.Error(i).message());
                         }
                         continue;
                     }
-                    search(results, cur_path, "**", {}, type, use_regex, silence, callback);
+                    PathInfo info;
+                    entry_path_info(dir_path, stats.Name(i), stats.Stat(i), fields, info);
+                    if (options.ignore_sepcial_file && is_special_type(info.type))
+                    {
+                        continue;
+                    }
+                    names.emplace_back(stats.Name(i));
+                    listing.push_back(std::move(info));
                 }
-                return;
-            }
-
-            bool is_dir2;
-            std::string cur_name;
-            fs::path cur_path;
-            try
-            {
-                for (auto &entry : fs::directory_iterator(root))
+                GetIOCounters().stats.fetch_add(dir.GetStatCalls(), std::memory_order_relaxed);
+                // 有条目取不到元数据时不写入快照, 下次重新枚举
+                complete_listing = dir.IsOpen() && !dir.GetError() && !stop && !stat_failed;
+                if (track && complete_listing)
                 {
-                    cur_name = entry.path().filename().string();
-                    cur_path = AMPath::join(root, cur_name);
-                    if (!AMPathTools::_match(cur_name, name, use_regex))
+                    std::vector<size_t> order(names.size());
+                    for (size_t i = 0; i < order.size(); i++)
                     {
-                        continue;
+                        order[i] = i;
                     }
-                    is_dir2 = fs::is_directory(cur_path);
-                    if (is_dir2 && type != AMPathTools::ENUMS::SearchType::File)
+                    std::sort(order.begin(), order.end(), [&names](size_t a, size_t b)
+                              { return names[a] < names[b]; });
+                    std::vector<std::string> sorted_names;
+                    std::vector<PathInfo> sorted_listing;
+                    for (size_t i : order)
                     {
-                        results.push_back(cur_path.string());
+                        sorted_names.push_back(std::move(names[i]));
+                        sorted_listing.push_back(std::move(listing[i]));
                     }
-                    else if (!is_dir2 && type != AMPathTools::ENUMS::SearchType::Directory)
+                    names = std::move(sorted_names);
+                    listing = std::move(sorted_listing);
+                    // 没有记录又不是新目录时 (上次枚举不完整, 被剪枝等) 无从比较, 不报告
+                    if (baseline.IsLoaded() && (record || node->is_new))
                     {
-                        results.push_back(cur_path.string());
+                        std::vector<WalkChange> changes;
+                        diff(record, dir_path, names, listing, node->scope, changes, added);
+                        report(changes);
                     }
                 }
             }
-            catch (const std::exception e)
+
+            if (has_mtime && complete_listing)
+            {
+                AMPathTools::SnapshotDir snap_dir;
+                snap_dir.path = node->info.path;
+                // 修改时间与读取时间过近时, 同一时间粒度内的后续改动可能不会改变修改时间, 下次不信任这条记录 (条目仍用于比较)
+                uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+                snap_dir.mtime = now > dir_mtime + AMPathTools::mtime_granularity(dir_mtime) ? dir_mtime : 0;
+                for (size_t i = 0; i < listing.size(); i++)
+                {
+                    const PathInfo &info = listing[i];
+                    snap_dir.entries.push_back({names[i], info.uname, info.mode_str, static_cast<int32_t>(info.type), static_cast<uint32_t>(info.mode_int), info.size, info.atime, info.mtime});
+                }
+                records[worker].push_back(std::move(snap_dir));
+            }
+
+            for (size_t i = 0; i < listing.size(); i++)
             {
-                std::cout << "error: " << e.what() << std::endl;
-                if (!silence && callback)
+                PathInfo &info = listing[i];
+                bool is_dir = info.type == AMPathTools::ENUMS::PathType::DIR;
+                if (node->scope.Excludes(names[i], is_dir))
+                {
+                    continue;
+                }
+                if (!is_dir || pruned(info))
+                {
+                    emit(batch, std::move(info));
+                    continue;
+                }
+                auto child = std::make_shared<Node>();
+                child->parent = bottom_up ? node : nullptr;
+                child->is_new = !added.empty() && added[i];
+                if (node->scope.Active())
+                {
+                    child->scope = node->scope.Enter(fs::path(info.path), names[i]);
+                }
+                if (!bottom_up)
                 {
-                    (*callback)(root.string(), "IterdirFailed", e.what());
+                    emit(batch, info);
                 }
+                child->info = std::move(info);
+                children.push_back(std::move(child));
+            }
+            // 先交付本目录的条目, 再派发子目录, 保证父子之间的先后
+            if (bottom_up)
+            {
+                node->pending += children.size();
+            }
+            flush(batch);
+            for (auto &child : children)
+            {
+                pool.Push(worker, [&scan, child](size_t cur_worker)
+                          { scan(cur_worker, child); });
+            }
+            if (bottom_up)
+            {
+                complete(node, batch);
+            }
+        };
+
+        auto root = std::make_shared<Node>();
+        root->info = root_info;
+        root->scope = AMPathTools::IgnoreScope::Root(options.exclude, fs::path(root_info.path), options.read_gitignore);
+        if (!bottom_up)
+        {
+            std::vector<PathInfo> head = {root_info};
+            flush(head);
+        }
+        if (!pruned(root_info))
+        {
+            pool.Run([&](size_t worker)
+                     { scan(worker, root); });
+        }
+        else if (bottom_up)
+        {
+            std::vector<PathInfo> tail = {root_info};
+            flush(tail);
+        }
+        if (track && !stop)
+        {
+            std::vector<AMPathTools::SnapshotDir> dirs;
+            for (auto &part : records)
+            {
+                dirs.insert(dirs.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+            }
+            // Windows 下被映射的文件不能被替换, 先释放旧快照
+            baseline.Close();
+            uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+            if (!AMPathTools::save_snapshot(options.snapshot, dirs, snapshot_flags, now) && locked)
+            {
+                (*locked)(options.snapshot, "SnapshotSaveFailed", "Fail to write the walk snapshot");
             }
         }
+        return !stop;
+    }
+
+    std::vector<PathInfo> walk(const std::string &path, bool ignore_sepcial_file, bool trace_link)
+    {
+        std::vector<PathInfo> results = {};
+        WalkOptions options;
+        options.ignore_sepcial_file = ignore_sepcial_file;
+        options.trace_link = trace_link;
+        walk_each(
+            path, [&results](std::vector<PathInfo> &batch)
+            {
+                results.insert(results.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+                return true; },
+            options);
+        return results;
     }
 
-    std::vector<std::string> find(const std::string &path_f, AMPathTools::ENUMS::SearchType type = AMPathTools::ENUMS::SearchType::All, bool use_regex = false, bool silence = false, CB callback = nullptr)
+    // 拉取式的遍历: 后台线程产出批次写入有界队列, 调用方用 Next 逐批取出
+    class WalkStream
     {
+    public:
+        WalkStream(const std::string &path, const WalkOptions &options = {}, CB callback = nullptr, size_t capacity = 16) : queue(capacity)
+        {
+            producer = std::thread([this, path, options, callback]()
+                                   {
+                                       try
+                                       {
+                                           walk_each(path, [this](std::vector<PathInfo> &batch)
+                                                     { return queue.Push(std::move(batch)); },
+                                                     options, callback);
+                                       }
+                                       catch (const std::exception &e)
+                                       {
+                                           if (callback)
+                                           {
+                                               (*callback)(path, "WalkFailed", e.what());
+                                           }
+                                       }
+                                       queue.Finish(); });
+        }
 
-        std::string path = path_f;
-        if (fs::exists(path) && !use_regex)
+        WalkStream(const WalkStream &) = delete;
+        WalkStream &operator=(const WalkStream &) = delete;
+
+        ~WalkStream()
+        {
+            Close();
+        }
+
+        // 阻塞直到取得下一批; 遍历结束且队列取空后返回 false
+        bool Next(std::vector<PathInfo> &batch)
         {
-            return std::vector<std::string>{path};
+            return queue.Pop(batch);
         }
-        auto pre_result = preprocess(path, use_regex);
-        auto match_parts = std::get<0>(pre_result);
-        auto root_path = std::get<1>(pre_result);
-        bool is_recursive = std::get<2>(pre_result);
-        std::vector<std::string> results;
-        amprint("root: ", root_path);
 
-        if (root_path.empty())
+        void Close()
         {
-            if (callback)
+            queue.Cancel();
+            if (producer.joinable())
             {
-                (*callback)(path_f, "FailToParsingRoot", "Parsed Root is Empty");
+                producer.join();
             }
-            return {};
         }
 
-        if (!fs::exists(root_path))
+    private:
+        AMPathTools::BoundedQueue<std::vector<PathInfo>> queue;
+        std::thread producer;
+    };
+
+    // 某一行的只读视图, 字符串指向表内的存储, 表被修改后失效
+    struct PathInfoView
+    {
+        std::string_view name;
+        std::string_view dir;
+        std::string_view uname;
+        std::string_view mode_str;
+        // 完整路径为 path_prefix + path_tail, 多数行 path_tail 就是 name
+        std::string_view path_prefix;
+        std::string_view path_tail;
+        uint64_t size = 0;
+        uint64_t atime = 0;
+        uint64_t mtime = 0;
+        AMPathTools::ENUMS::PathType type = AMPathTools::ENUMS::PathType::FILE;
+        uint64_t mode_int = 0777;
+
+        std::string Path() const
         {
-            return {};
+            std::string path;
+            path.reserve(path_prefix.size() + path_tail.size());
+            path.append(path_prefix).append(path_tail);
+            return path;
         }
 
-        if (match_parts.empty())
+        PathInfo ToPathInfo() const
         {
-            return std::vector<std::string>{root_path};
+            return PathInfo(std::string(name), Path(), std::string(dir), std::string(uname), size, atime, mtime, type, mode_int, std::string(mode_str));
         }
+    };
 
-        if (use_regex)
+    // 按列存储的 PathInfo 结果集: 数值字段各占一列, 名字连续存放在一块内存中 (name_offsets 共 Size() + 1 项),
+    // 每行只记录所在目录的编号, 目录 / 属主 / 权限字符串各只存一份
+    class PathInfoTable
+    {
+    public:
+        PathInfoTable()
+        {
+            name_offsets.push_back(0);
+        }
+
+        PathInfoTable(const PathInfoTable &) = delete;
+        PathInfoTable &operator=(const PathInfoTable &) = delete;
+        PathInfoTable(PathInfoTable &&) = default;
+        PathInfoTable &operator=(PathInfoTable &&) = default;
+
+        void Reserve(size_t rows, size_t name_bytes = 0)
+        {
+            name_offsets.reserve(rows + 1);
+            names.reserve(name_bytes);
+            dir_ids.reserve(rows);
+            sizes.reserve(rows);
+            atimes.reserve(rows);
+            mtimes.reserve(rows);
+            types.reserve(rows);
+            modes.reserve(rows);
+            mode_ids.reserve(rows);
+            owner_ids.reserve(rows);
+        }
+
+        void Append(const PathInfo &info)
         {
-            auto reg_check = AMPathTools::isPatternsValid(match_parts);
-            if (std::holds_alternative<std::string>(reg_check))
+            size_t row = Size();
+            uint32_t dir_id = InternDir(info.dir);
+            DirRecord &dir = dirs[dir_id];
+            // 路径能由目录前缀加名字还原时不单独保存
+            std::string_view path = info.path;
+            std::string_view name = info.name;
+            if (!dir.has_prefix && path.size() >= name.size() && path.substr(path.size() - name.size()) == name)
             {
-                if (callback)
-                {
-                    (*callback)(path_f, "RegexSytanxError", std::get<std::string>(reg_check));
-                }
-                return {};
+                dir.prefix = std::string(path.substr(0, path.size() - name.size()));
+                dir.has_prefix = true;
+            }
+            if (!dir.has_prefix || path.size() != dir.prefix.size() + name.size() || path.substr(0, dir.prefix.size()) != dir.prefix || path.substr(dir.prefix.size()) != name)
+            {
+                path_overrides.emplace(row, info.path);
+            }
+            names.append(info.name);
+            name_offsets.push_back(names.size());
+            dir_ids.push_back(dir_id);
+            sizes.push_back(info.size);
+            atimes.push_back(info.atime);
+            mtimes.push_back(info.mtime);
+            types.push_back(static_cast<int8_t>(info.type));
+            modes.push_back(static_cast<uint32_t>(info.mode_int));
+            mode_ids.push_back(Intern(mode_strs, mode_lookup, info.mode_str));
+            owner_ids.push_back(Intern(owners, owner_lookup, info.uname));
+        }
+
+        size_t Size() const
+        {
+            return dir_ids.size();
+        }
+
+        bool Empty() const
+        {
+            return dir_ids.empty();
+        }
+
+        std::string_view Name(size_t row) const
+        {
+            return std::string_view(names.data() + name_offsets[row], static_cast<size_t>(name_offsets[row + 1] - name_offsets[row]));
+        }
+
+        std::string_view Dir(size_t row) const
+        {
+            return dirs[dir_ids[row]].dir;
+        }
+
+        std::string Path(size_t row) const
+        {
+            return Row(row).Path();
+        }
+
+        std::string_view Owner(size_t row) const
+        {
+            return owners[owner_ids[row]];
+        }
+
+        std::string_view ModeStr(size_t row) const
+        {
+            return mode_strs[mode_ids[row]];
+        }
+
+        AMPathTools::ENUMS::PathType Type(size_t row) const
+        {
+            return static_cast<AMPathTools::ENUMS::PathType>(types[row]);
+        }
+
+        PathInfoView Row(size_t row) const
+        {
+            PathInfoView view;
+            view.name = Name(row);
+            view.dir = Dir(row);
+            view.uname = Owner(row);
+            view.mode_str = ModeStr(row);
+            auto it = path_overrides.empty() ? path_overrides.end() : path_overrides.find(row);
+            if (it != path_overrides.end())
+            {
+                view.path_prefix = it->second;
+            }
+            else
+            {
+                view.path_prefix = dirs[dir_ids[row]].prefix;
+                view.path_tail = view.name;
+            }
+            view.size = sizes[row];
+            view.atime = atimes[row];
+            view.mtime = mtimes[row];
+            view.type = Type(row);
+            view.mode_int = modes[row];
+            return view;
+        }
+
+        PathInfo Get(size_t row) const
+        {
+            return Row(row).ToPathInfo();
+        }
+
+        std::vector<PathInfo> ToVector() const
+        {
+            std::vector<PathInfo> result;
+            result.reserve(Size());
+            for (size_t i = 0; i < Size(); i++)
+            {
+                result.push_back(Get(i));
             }
+            return result;
+        }
+
+        // 各列的原始数据, 供按列处理或导出
+        const std::string &NameBytes() const
+        {
+            return names;
+        }
+
+        const std::vector<uint64_t> &NameOffsets() const
+        {
+            return name_offsets;
         }
 
-        std::string name_first = match_parts.front();
-        match_parts.erase(match_parts.begin());
+        const std::vector<uint32_t> &DirIds() const
+        {
+            return dir_ids;
+        }
 
-        if (root_path.find("\\") == std::string::npos && root_path.find("/") == std::string::npos)
+        const std::vector<uint64_t> &Sizes() const
         {
-            root_path = root_path + "\\";
+            return sizes;
         }
 
-        AMPath::search(results, fs::path(root_path), name_first, match_parts, type, use_regex, silence, callback);
-        return results;
+        const std::vector<uint64_t> &Atimes() const
+        {
+            return atimes;
+        }
+
+        const std::vector<uint64_t> &Mtimes() const
+        {
+            return mtimes;
+        }
+
+        const std::vector<int8_t> &Types() const
+        {
+            return types;
+        }
+
+        const std::vector<uint32_t> &Modes() const
+        {
+            return modes;
+        }
+
+        const std::vector<uint32_t> &ModeIds() const
+        {
+            return mode_ids;
+        }
+
+        const std::vector<uint32_t> &OwnerIds() const
+        {
+            return owner_ids;
+        }
+
+
+        // 编号对应的目录 / 权限字符串 / 属主
+        size_t DirCount() const
+        {
+            return dirs.size();
+        }
+
+        std::string_view DirName(uint32_t id) const
+        {
+            return dirs[id].dir;
+        }
+
+        size_t ModeStrCount() const
+        {
+            return mode_strs.size();
+        }
+
+        std::string_view ModeStrName(uint32_t id) const
+        {
+            return mode_strs[id];
+        }
+
+        size_t OwnerCount() const
+        {
+            return owners.size();
+        }
+
+        std::string_view OwnerName(uint32_t id) const
+        {
+            return owners[id];
+        }
+
+        // 粗略的内存占用 (字节), 不含容器自身的簿记开销
+        size_t MemoryUsage() const
+        {
+            size_t bytes = names.capacity() + name_offsets.capacity() * sizeof(uint64_t) + dir_ids.capacity() * sizeof(uint32_t) +
+                           (sizes.capacity() + atimes.capacity() + mtimes.capacity()) * sizeof(uint64_t) + types.capacity() +
+                           (modes.capacity() + mode_ids.capacity() + owner_ids.capacity()) * sizeof(uint32_t);
+            for (auto &dir : dirs)
+            {
+                bytes += sizeof(DirRecord) + dir.dir.capacity() + dir.prefix.capacity();
+            }
+            for (auto &str : mode_strs)
+            {
+                bytes += sizeof(std::string) + str.capacity();
+            }
+            for (auto &str : owners)
+            {
+                bytes += sizeof(std::string) + str.capacity();
+            }
+            for (auto &[row, path] : path_overrides)
+            {
+                bytes += sizeof(row) + sizeof(path) + path.capacity();
+            }
+            return bytes;
+        }
+
+    private:
+        struct DirRecord
+        {
+            std::string dir;
+            // 该目录下条目路径的公共前缀 (一般为规范化后的目录路径加分隔符)
+            std::string prefix;
+            bool has_prefix = false;
+        };
+
+        std::string names;
+        std::vector<uint64_t> name_offsets;
+        std::vector<uint32_t> dir_ids;
+        std::vector<uint64_t> sizes;
+        std::vector<uint64_t> atimes;
+        std::vector<uint64_t> mtimes;
+        std::vector<int8_t> types;
+        std::vector<uint32_t> modes;
+        std::vector<uint32_t> mode_ids;
+        std::vector<uint32_t> owner_ids;
+
+        // deque 中的元素地址不变, 查找表可以直接引用
+        std::deque<DirRecord> dirs;
+        std::unordered_map<std::string_view, uint32_t> dir_lookup;
+        uint32_t last_dir = UINT32_MAX;
+        std::deque<std::string> mode_strs;
+        std::unordered_map<std::string_view, uint32_t> mode_lookup;
+        std::deque<std::string> owners;
+        std::unordered_map<std::string_view, uint32_t> owner_lookup;
+        // 路径不能由前缀加名字还原的行 (如遍历的根)
+        std::unordered_map<size_t, std::string> path_overrides;
+
+        uint32_t InternDir(const std::string &dir)
+        {
+            // 同一目录的条目通常连续到达
+            if (last_dir != UINT32_MAX && dirs[last_dir].dir == dir)
+            {
+                return last_dir;
+            }
+            auto it = dir_lookup.find(dir);
+            if (it == dir_lookup.end())
+            {
+                dirs.push_back({dir, "", false});
+                it = dir_lookup.emplace(dirs.back().dir, static_cast<uint32_t>(dirs.size() - 1)).first;
+            }
+            last_dir = it->second;
+            return last_dir;
+        }
+
+        static uint32_t Intern(std::deque<std::string> &values, std::unordered_map<std::string_view, uint32_t> &lookup, const std::string &value)
+        {
+            auto it = lookup.find(value);
+            if (it != lookup.end())
+            {
+                return it->second;
+            }
+            values.push_back(value);
+            return lookup.emplace(values.back(), static_cast<uint32_t>(values.size() - 1)).first->second;
+        }
+    };
+
+    // 与 listdir 相同, 结果按列存储
+    PathInfoTable listdir_table(const std::string &path, uint32_t fields = STAT_ALL, CB callback = nullptr)
+    {
+        PathInfoTable table;
+        listdir_each(
+            path, [&table](PathInfo &info)
+            { table.Append(info); },
+            fields, callback);
+        return table;
+    }
+
+    // 与 walk_each 相同的遍历, 结果按列存储; 每批 PathInfo 追加后即释放, 峰值内存只有一批
+    PathInfoTable walk_table(const std::string &path, const WalkOptions &options = {}, CB callback = nullptr)
+    {
+        PathInfoTable table;
+        walk_each(
+            path, [&table](std::vector<PathInfo> &batch)
+            {
+                for (auto &info : batch)
+                {
+                    table.Append(info);
+                }
+                return true; },
+            options, callback);
+        return table;
+    }
+
+    struct SizeInfo
+    {
+        // 文件长度之和与实际占用的磁盘空间 (POSIX 为 st_blocks * 512)
+        uint64_t apparent = 0;
+        uint64_t allocated = 0;
+        size_t files = 0;
+        size_t dirs = 0;
+        // 因硬链接去重而跳过的文件数
+        size_t hardlinks = 0;
+    };
+
+    // 并行统计目录大小: 每个目录一个任务, 各线程累加到自己的 SizeInfo, 结束后合并;
+    // 每个条目至多一次元数据调用, 目录按 (设备, inode) 只统计一次;
+    // trace_link 为 true 时跟随子项中的链接, dedup 为 true 时多个硬链接只计一次; threads 为 0 时使用硬件线程数;
+    // exclude 为相对 path 的 gitignore 规则, 被排除的条目不计入且不做任何调用, read_gitignore 为 true 时同时读取各目录的 .gitignore
+    SizeInfo getsize_info(const std::string &path, bool trace_link = false, bool dedup = true, size_t threads = 0, std::shared_ptr<const AMPathTools::IgnoreRules> exclude = nullptr, bool read_gitignore = false)
+    {
+        SizeInfo total;
+        fs::path root(path);
+        AMPathTools::EntryStat root_info;
+        if (!AMPathTools::stat_path(root, root_info, true))
+        {
+            return total;
+        }
+        if (root_info.type != AMPathTools::EntryType::Directory)
+        {
+            if (root_info.type == AMPathTools::EntryType::File)
+            {
+                total.apparent = root_info.size;
+                total.allocated = root_info.allocated;
+                total.files = 1;
+            }
+            return total;
+        }
+
+        AMPathTools::WorkPool pool(threads);
+        std::vector<SizeInfo> sums(pool.Size());
+        std::mutex seen_mutex;
+        AMPathTools::FileIdSet seen_dirs;
+        AMPathTools::FileIdSet seen_files;
+        auto first_seen = [&](AMPathTools::FileIdSet &set, const AMPathTools::FileId &id)
+        {
+            std::lock_guard<std::mutex> lock(seen_mutex);
+            return set.Insert(id);
+        };
+        std::function<void(size_t, const fs::path &, const AMPathTools::IgnoreScope &)> scan;
+        auto descend = [&](size_t worker, const fs::path &child, std::string_view name, const AMPathTools::IgnoreScope &scope)
+        {
+            AMPathTools::IgnoreScope child_scope = scope.Active() ? scope.Enter(child, name) : AMPathTools::IgnoreScope{};
+            pool.Push(worker, [&scan, child, child_scope](size_t cur_worker)
+                      { scan(cur_worker, child, child_scope); });
+        };
+        scan = [&](size_t worker, const fs::path &dir_path, const AMPathTools::IgnoreScope &scope)
+        {
+            AMPathTools::DirEnumerator dir(dir_path);
+            AMPathTools::FileId dir_id;
+            if (!dir.IsOpen() || (dir.GetId(dir_id) && !first_seen(seen_dirs, dir_id)))
+            {
+                return;
+            }
+            SizeInfo &sum = sums[worker];
+            sum.dirs++;
+            AMPathTools::DirEntry entry;
+            AMPathTools::EntryStat info;
+            while (dir.Next(entry))
+            {
+                if (entry.type == AMPathTools::EntryType::Directory)
+                {
+                    if (!scope.Excludes(entry.name, true))
+                    {
+                        descend(worker, dir_path / AMPathTools::path_from_utf8(entry.name), entry.name, scope);
+                    }
+                    continue;
+                }
+                // 不跟随链接时, 已知是链接的条目无需任何调用
+                if ((entry.type == AMPathTools::EntryType::Symlink && !trace_link) || entry.type == AMPathTools::EntryType::Other)
+                {
+                    continue;
+                }
+                if (entry.type == AMPathTools::EntryType::File && scope.Excludes(entry.name, false))
+                {
+                    continue;
+                }
+                if (!dir.StatEntry(entry, info, trace_link))
+                {
+                    continue;
+                }
+                if (entry.type != AMPathTools::EntryType::File && scope.Excludes(entry.name, info.type == AMPathTools::EntryType::Directory))
+                {
+                    continue;
+                }
+                if (info.type == AMPathTools::EntryType::Directory)
+                {
+                    descend(worker, dir_path / AMPathTools::path_from_utf8(entry.name), entry.name, scope);
+                    continue;
+                }
+                if (info.type != AMPathTools::EntryType::File)
+                {
+                    continue;
+                }
+                if (dedup && info.links > 1 && !first_seen(seen_files, info.id))
+                {
+                    sum.hardlinks++;
+                    continue;
+                }
+                sum.files++;
+                sum.apparent += info.size;
+                sum.allocated += info.allocated;
+            }
+        };
+        AMPathTools::IgnoreScope root_scope = AMPathTools::IgnoreScope::Root(exclude, root, read_gitignore);
+        pool.Run([&](size_t worker)
+                 { scan(worker, root, root_scope); });
+        for (auto &sum : sums)
+        {
+            total.apparent += sum.apparent;
+            total.allocated += sum.allocated;
+            total.files += sum.files;
+            total.dirs += sum.dirs;
+            total.hardlinks += sum.hardlinks;
+        }
+        return total;
+    }
+
+    // 文件长度之和, 不去重硬链接; threads 为 0 时使用硬件线程数,
+    // 按目录并行, 目录多且元数据读取有延迟 (冷缓存, 网络文件系统) 时才有收益, 默认单线程
+    uint64_t getsize(const std::string &path, bool trace_link = false, size_t threads = 1)
+    {
+        return getsize_info(path, trace_link, false, threads).apparent;
+    }
+
+    // 拆分为根目录与待匹配的段, 匹配段保持原始字符串
+    std::tuple<std::vector<std::string>, std::string, bool> preprocess_parts(std::string path, bool use_regex)
+    {
+
+        VStrip(path);
+
+        std::string sep = GetPathSep(path);
+
+        if (!is_absolute(path))
+        {
+            path = HomePath() + sep + path;
+        }
+
+        std::vector<std::string> ori_parts;
+        if (use_regex)
+        {
+            ori_parts = AMPath::resplit(path, '<', '>', "<");
+        }
+        else
+        {
+            ori_parts = AMPath::split(path);
+        }
+
+        std::vector<std::string> path_parts = {};
+
+        bool is2star = false;
+        bool is_recursive = false;
+        for (int i = 0; i < ori_parts.size(); i++)
+        {
+            auto part = ori_parts[i];
+            if (part == "**")
+            {
+                is_recursive = true;
+                if (is2star)
+                {
+                    continue;
+                }
+                else
+                {
+                    is2star = true;
+                    path_parts.push_back(part);
+                }
+            }
+            else
+            {
+                is2star = false;
+                path_parts.push_back(part);
+            }
+        }
+
+        std::vector<std::string> match_parts;
+        std::vector<std::string> root_parts;
+
+        int num_i = 0;
+        bool is_match;
+        bool is_end = false;
+        for (int i = 0; i < path_parts.size(); i++)
+        {
+            auto part = path_parts[i];
+            if (is_end)
+            {
+                match_parts.push_back(part);
+                continue;
+            }
+
+            if (use_regex)
+            {
+                is_match = part[0] == '<' || part.find_first_of("*?[{") != std::string::npos;
+            }
+            else
+            {
+                is_match = part.find_first_of("*?[{") != std::string::npos;
+            }
+
+            if (is_match)
+            {
+                match_parts.push_back(part);
+                is_end = true;
+            }
+            else
+            {
+                root_parts.push_back(part);
+            }
+        }
+
+        return std::make_tuple(match_parts, AMPath::realpath(AMPath::join(root_parts), false, PreferredSep), is_recursive);
+    }
+
+    std::tuple<std::vector<AMPathTools::PatternPtr>, std::string, bool> preprocess(std::string path, bool use_regex, bool ignore_case = AMPathTools::DefaultIgnoreCase)
+    {
+        auto [parts, root_path, is_recursive] = preprocess_parts(path, use_regex);
+        std::vector<AMPathTools::PatternPtr> match_parts;
+        for (auto &part : parts)
+        {
+            match_parts.push_back(AMPathTools::GetCompiledPattern(AMPathTools::AMutf8(part), use_regex, ignore_case));
+        }
+        return std::make_tuple(match_parts, root_path, is_recursive);
+    }
+
+    struct SearchState
+    {
+        size_t pattern;
+        size_t index;
+
+        bool operator<(const SearchState &other) const
+        {
+            return pattern < other.pattern || (pattern == other.pattern && index < other.index);
+        }
+
+        bool operator==(const SearchState &other) const
+        {
+            return pattern == other.pattern && index == other.index;
+        }
+    };
+
+    // 遍历结束的原因
+    enum class FindStatus
+    {
+        Complete = 0,
+        MaxResults = 1,
+        Deadline = 2,
+        Cancelled = 3
+    };
+
+    // find 的限制条件, 各项为 0 或空时不限制; 触发任一限制时遍历尽快停止并返回已找到的部分结果
+    struct FindLimits
+    {
+        // 相对模式根目录的层数, 1 表示只看根目录的直接子项
+        size_t max_depth = 0;
+        size_t max_results = 0;
+        std::optional<std::chrono::steady_clock::time_point> deadline;
+        // 调用方在任意线程置为 true 即可取消
+        std::shared_ptr<std::atomic<bool>> cancel;
+        // gitignore 语法的排除规则, 相对分组后的遍历根目录; 被排除的目录不会被打开
+        std::shared_ptr<const AMPathTools::IgnoreRules> exclude;
+        // 同时读取遍历中遇到的 .gitignore, 其规则作用于所在目录及以下
+        bool read_gitignore = false;
+        // 模式不区分大小写 (Unicode 简单折叠); 默认区分, Windows 上也一样
+        bool ignore_case = false;
+
+        static FindLimits Within(std::chrono::milliseconds budget)
+        {
+            FindLimits limits;
+            limits.deadline = std::chrono::steady_clock::now() + budget;
+            return limits;
+        }
+    };
+
+    // 一次查找内所有遍历线程共享的限制状态, 同时记录经链接进入过的目录
+    class TraverseBudget
+    {
+    public:
+        TraverseBudget(const FindLimits &limits, std::vector<size_t> depths = {}) : limits(limits), depths(std::move(depths)) {}
+
+        // 超时或被取消时记录原因并返回 true
+        bool Expired()
+        {
+            if (limits.cancel && limits.cancel->load(std::memory_order_relaxed))
+            {
+                Halt(FindStatus::Cancelled);
+                return true;
+            }
+            if (limits.deadline && std::chrono::steady_clock::now() >= *limits.deadline)
+            {
+                Halt(FindStatus::Deadline);
+                return true;
+            }
+            return false;
+        }
+
+        // 为一个结果占位, 已达上限时返回 false; 取得最后一个名额时同时记录停止原因
+        bool Claim()
+        {
+            if (limits.cancel && limits.cancel->load(std::memory_order_relaxed))
+            {
+                Halt(FindStatus::Cancelled);
+                return false;
+            }
+            if (limits.max_results == 0)
+            {
+                return true;
+            }
+            size_t index = results.fetch_add(1);
+            if (index >= limits.max_results)
+            {
+                return false;
+            }
+            if (index + 1 == limits.max_results)
+            {
+                Halt(FindStatus::MaxResults);
+            }
+            return true;
+        }
+
+        bool Full() const
+        {
+            return limits.max_results != 0 && results.load() >= limits.max_results;
+        }
+
+        // 遍历根下第 depth 层的条目对 pattern 而言是否仍在层数限制内
+        bool InDepth(size_t pattern, size_t depth) const
+        {
+            if (limits.max_depth == 0)
+            {
+                return true;
+            }
+            size_t base = pattern < depths.size() ? depths[pattern] : 0;
+            return depth <= base + limits.max_depth;
+        }
+
+        void Halt(FindStatus reason)
+        {
+            int expected = static_cast<int>(FindStatus::Complete);
+            status.compare_exchange_strong(expected, static_cast<int>(reason));
+        }
+
+        FindStatus GetStatus() const
+        {
+            return static_cast<FindStatus>(status.load());
+        }
+
+        // 记录每个实际枚举的目录 (含遍历根), 同一目录经由链接或成环再次到达时返回 false
+        bool EnterDir(const AMPathTools::FileId &id)
+        {
+            std::lock_guard<std::mutex> lock(visited_mutex);
+            return visited.Insert(id);
+        }
+
+        // 每组模式各自从根开始遍历, 前一组进入过的目录对下一组不算重复
+        void ResetDirs()
+        {
+            std::lock_guard<std::mutex> lock(visited_mutex);
+            visited.Clear();
+        }
+
+        // 链接目标已经枚举过 (包括指回祖先的链接) 时不再进入
+        bool Entered(const AMPathTools::FileId &id)
+        {
+            std::lock_guard<std::mutex> lock(visited_mutex);
+            return visited.Contains(id);
+        }
+
+    private:
+        FindLimits limits;
+        std::vector<size_t> depths;
+        std::mutex visited_mutex;
+        AMPathTools::FileIdSet visited;
+        std::atomic<size_t> results = 0;
+        std::atomic<int> status = static_cast<int>(FindStatus::Complete);
+    };
+
+    // 遍历核心的单层步骤: Matcher 为指向匹配器的指针类型 (PatternPtr 或 const CompiledPattern *),
+    // Sink 形如 bool(const fs::path &path, bool is_dir), 返回 false 时终止整个遍历;
+    // 子目录交给 descend(path, states, report_empty, scope) 继续, report_empty 表示该目录为空时应上报自身;
+    // 同时推进多个模式的匹配状态, 每个目录只枚举一次; 返回目录是否成功枚举且为空;
+    // budget 非空时检查超时与取消, depth 为 root 相对遍历根的层数, scope 中被排除的条目既不匹配也不进入
+    template <typename Matcher, typename Sink, typename Descend>
+    bool scan_directory(const fs::path &root, const std::vector<std::vector<Matcher>> &patterns, std::vector<SearchState> states, AMPathTools::ENUMS::SearchType type, Sink &sink, std::atomic<bool> &stop, bool silence, CB callback, Descend &&descend, TraverseBudget *budget = nullptr, size_t depth = 0, const AMPathTools::IgnoreScope &scope = {})
+    {
+        if (budget && budget->Expired())
+        {
+            stop = true;
+            return false;
+        }
+        // ** 可以匹配零层目录, 其后的段同样作用于当前目录
+        for (size_t k = 0; k < states.size(); k++)
+        {
+            const auto &parts = patterns[states[k].pattern];
+            if (parts[states[k].index]->IsRecursive() && states[k].index + 1 < parts.size())
+            {
+                states.push_back({states[k].pattern, states[k].index + 1});
+            }
+        }
+        std::sort(states.begin(), states.end());
+        states.erase(std::unique(states.begin(), states.end()), states.end());
+
+        // 缓存保证相同的段共享同一个匹配器, 每个条目对每个匹配器只计算一次
+        using Pattern = std::remove_reference_t<decltype(*std::declval<const Matcher &>())>;
+        std::vector<Pattern *> matchers;
+        std::vector<size_t> state_matcher(states.size());
+        for (size_t k = 0; k < states.size(); k++)
+        {
+            Pattern *matcher = &*patterns[states[k].pattern][states[k].index];
+            auto it = std::find(matchers.begin(), matchers.end(), matcher);
+            state_matcher[k] = it - matchers.begin();
+            if (it == matchers.end())
+            {
+                matchers.push_back(matcher);
+            }
+        }
+
+        std::vector<char> matched(matchers.size());
+        std::vector<SearchState> child_states;
+        auto emit = [&](const fs::path &cur_path, bool is_dir)
+        {
+            if (is_dir ? type == AMPathTools::ENUMS::SearchType::File : type == AMPathTools::ENUMS::SearchType::Directory)
+            {
+                return;
+            }
+            if (!sink(cur_path, is_dir))
+            {
+                stop = true;
+            }
+        };
+        // 路径只在命中或需要下探时才拼接; descendable 为 false 时是已经进入过的链接目录
+        auto visit = [&](std::string_view cur_name, bool is_dir, bool descendable = true)
+        {
+            if (scope.Excludes(cur_name, is_dir))
+            {
+                return;
+            }
+            for (size_t m = 0; m < matchers.size(); m++)
+            {
+                matched[m] = matchers[m]->Match(cur_name);
+            }
+
+            bool hit = false;
+            bool tail_recursive = false;
+            child_states.clear();
+            for (size_t k = 0; k < states.size(); k++)
+            {
+                if (!matched[state_matcher[k]])
+                {
+                    continue;
+                }
+                const SearchState &state = states[k];
+                if (budget && !budget->InDepth(state.pattern, depth + 1))
+                {
+                    continue;
+                }
+                bool can_descend = !budget || budget->InDepth(state.pattern, depth + 2);
+                const auto &parts = patterns[state.pattern];
+                bool is_last = state.index + 1 == parts.size();
+                if (parts[state.index]->IsRecursive())
+                {
+                    if (is_dir && can_descend)
+                    {
+                        child_states.push_back(state);
+                        tail_recursive = tail_recursive || is_last;
+                    }
+                    else if (is_last)
+                    {
+                        hit = true;
+                    }
+                }
+                else if (is_last)
+                {
+                    hit = true;
+                }
+                else if (is_dir && can_descend)
+                {
+                    child_states.push_back({state.pattern, state.index + 1});
+                }
+            }
+
+            bool go_down = is_dir && descendable && !child_states.empty();
+            if (!hit && !go_down)
+            {
+                return;
+            }
+            fs::path cur_path = root / AMPathTools::path_from_utf8(cur_name);
+            if (hit)
+            {
+                emit(cur_path, is_dir);
+            }
+            if (go_down && !stop)
+            {
+                // 末尾的 ** 只收集文件与空目录
+                descend(cur_path, child_states, tail_recursive && !hit && type != AMPathTools::ENUMS::SearchType::File, scope.Active() ? scope.Enter(cur_path, cur_name) : AMPathTools::IgnoreScope{});
+            }
+        };
+
+        // 所有状态都是字面量段时直接探测目标是否存在, 不枚举目录
+        bool all_literal = std::all_of(matchers.begin(), matchers.end(), [](Pattern *matcher)
+                                       { return matcher->GetKind() == AMPathTools::CompiledPattern::Kind::Literal; });
+        if (all_literal)
+        {
+            std::vector<std::string> probed;
+            for (auto matcher : matchers)
+            {
+                const std::string &cur_name = matcher->GetSource();
+                if (std::find(probed.begin(), probed.end(), cur_name) != probed.end())
+                {
+                    continue;
+                }
+                probed.push_back(cur_name);
+                fs::path cur_path = root / AMPathTools::path_from_utf8(cur_name);
+                std::error_code ec;
+                GetIOCounters().probes.fetch_add(1, std::memory_order_relaxed);
+                fs::file_status status = fs::status(cur_path, ec);
+                if (ec || !fs::exists(status))
+                {
+                    continue;
+                }
+                visit(cur_name, fs::is_directory(status));
+                if (stop)
+                {
+                    break;
+                }
+            }
+            return false;
+        }
+
+        IOCounters &counters = GetIOCounters();
+        counters.dir_opens.fetch_add(1, std::memory_order_relaxed);
+        AMPathTools::DirEnumerator dir(root);
+        if (!dir.IsOpen())
+        {
+            if (!silence && callback)
+            {
+                (*callback)(root.string(), "IterdirFailed", dir.GetError().message());
+            }
+            return false;
+        }
+        // 同一目录经由不同路径到达时只枚举一次; 返回 false 使其不被当作空目录上报
+        AMPathTools::FileId dir_id;
+        if (budget && dir.GetId(dir_id) && !budget->EnterDir(dir_id))
+        {
+            return false;
+        }
+        size_t count = 0;
+        AMPathTools::DirEntry entry;
+        while (dir.Next(entry))
+        {
+            count++;
+            bool is_dir = entry.type == AMPathTools::EntryType::Directory;
+            bool descendable = true;
+            // 枚举结果已带类型, 只有符号链接或类型未知时才补一次 stat, 同时取得目标的标识
+            if (entry.type == AMPathTools::EntryType::Symlink || entry.type == AMPathTools::EntryType::Unknown)
+            {
+                AMPathTools::FileId id;
+                counters.stats.fetch_add(1, std::memory_order_relaxed);
+                is_dir = AMPathTools::get_dir_id(root / AMPathTools::path_from_utf8(entry.name), id);
+                descendable = !is_dir || !budget || !budget->Entered(id);
+            }
+            visit(entry.name, is_dir, descendable);
+            if (budget && count % 256 == 0 && budget->Expired())
+            {
+                stop = true;
+            }
+            if (stop)
+            {
+                break;
+            }
+        }
+        counters.entries.fetch_add(count, std::memory_order_relaxed);
+        if (dir.GetError())
+        {
+            if (!silence && callback)
+            {
+                (*callback)(root.string(), "IterdirFailed", dir.GetError().message());
+            }
+            return false;
+        }
+        return count == 0 && !stop;
+    }
+
+    // 单线程深度优先遍历, 返回根目录是否成功枚举且为空;
+    // 与并行版本一样先收集子目录, 当前目录关闭后再进入, 同一时刻只占用一个目录句柄与枚举缓冲区
+    template <typename Matcher, typename Sink>
+    bool traverse(const fs::path &root, const std::vector<std::vector<Matcher>> &patterns, std::vector<SearchState> states, AMPathTools::ENUMS::SearchType type, Sink &sink, std::atomic<bool> &stop, bool silence, CB callback, TraverseBudget *budget = nullptr, size_t depth = 0, const AMPathTools::IgnoreScope &scope = {})
+    {
+        struct Child
+        {
+            fs::path path;
+            std::vector<SearchState> states;
+            bool report_empty;
+            AMPathTools::IgnoreScope scope;
+        };
+        std::vector<Child> children;
+        auto descend = [&](const fs::path &path, const std::vector<SearchState> &child_states, bool report_empty, const AMPathTools::IgnoreScope &child_scope)
+        {
+            children.push_back({path, child_states, report_empty, child_scope});
+        };
+        bool is_root_empty = scan_directory(root, patterns, std::move(states), type, sink, stop, silence, callback, descend, budget, depth, scope);
+        for (auto &child : children)
+        {
+            if (stop)
+            {
+                break;
+            }
+            bool is_empty = traverse(child.path, patterns, std::move(child.states), type, sink, stop, silence, callback, budget, depth + 1, child.scope);
+            if (is_empty && child.report_empty && !stop && !sink(child.path, true))
+            {
+                stop = true;
+            }
+        }
+        return is_root_empty;
+    }
+
+    // 每个目录作为一个任务交给工作窃取线程池, Sink 形如 bool(size_t worker, const fs::path &path, bool is_dir);
+    // 回调可能来自任意线程, 这里统一加锁后再转发
+    template <typename Matcher, typename Sink>
+    void traverse_parallel(const fs::path &root, const std::vector<std::vector<Matcher>> &patterns, std::vector<SearchState> states, AMPathTools::ENUMS::SearchType type, AMPathTools::WorkPool &pool, Sink &sink, std::atomic<bool> &stop, bool silence, CB callback, TraverseBudget *budget = nullptr, const AMPathTools::IgnoreScope &scope = {})
+    {
+        CB locked = nullptr;
+        std::mutex callback_mutex;
+        if (callback)
+        {
+            locked = std::make_shared<std::function<void(std::string, std::string, std::string)>>(
+                [&](std::string path, std::string error, std::string msg)
+                {
+                    std::lock_guard<std::mutex> lock(callback_mutex);
+                    (*callback)(path, error, msg);
+                });
+        }
+        std::function<void(size_t, const fs::path &, const std::vector<SearchState> &, bool, size_t, const AMPathTools::IgnoreScope &)> scan;
+        scan = [&](size_t worker, const fs::path &path, const std::vector<SearchState> &dir_states, bool report_empty, size_t depth, const AMPathTools::IgnoreScope &dir_scope)
+        {
+            if (stop)
+            {
+                return;
+            }
+            auto worker_sink = [&](const fs::path &cur_path, bool is_dir)
+            {
+                return sink(worker, cur_path, is_dir);
+            };
+            auto descend = [&](const fs::path &child, const std::vector<SearchState> &child_states, bool child_report, const AMPathTools::IgnoreScope &child_scope)
+            {
+                pool.Push(worker, [&scan, child, child_states, child_report, depth, child_scope](size_t cur_worker)
+                          { scan(cur_worker, child, child_states, child_report, depth + 1, child_scope); });
+            };
+            bool is_empty = scan_directory(path, patterns, dir_states, type, worker_sink, stop, silence, locked, descend, budget, depth, dir_scope);
+            if (is_empty && report_empty && !stop && !sink(worker, path, true))
+            {
+                stop = true;
+            }
+        };
+        pool.Run([&](size_t worker)
+                 { scan(worker, root, states, false, 0, scope); });
+    }
+
+    // threads 大于 1 时并行遍历, 各线程先写入自己的缓冲区, 结束后按线程顺序合并
+    bool search_states(std::vector<std::string> &results, const fs::path &root, const std::vector<std::vector<AMPathTools::PatternPtr>> &patterns, std::vector<SearchState> states, AMPathTools::ENUMS::SearchType type, bool silence, CB callback, size_t threads = 1, TraverseBudget *budget = nullptr, const AMPathTools::IgnoreScope &scope = {})
+    {
+        std::atomic<bool> stop = false;
+        // 没有外部限制时也需要一份状态来记录链接目录
+        std::optional<TraverseBudget> local;
+        if (!budget)
+        {
+            local.emplace(FindLimits{});
+            budget = &*local;
+        }
+        if (threads == 1)
+        {
+            auto sink = [&results, budget](const fs::path &path, bool)
+            {
+                if (!budget->Claim())
+                {
+                    return false;
+                }
+                results.push_back(path.string());
+                return !budget->Full();
+            };
+            return traverse(root, patterns, std::move(states), type, sink, stop, silence, callback, budget, 0, scope);
+        }
+        AMPathTools::WorkPool pool(threads);
+        std::vector<std::vector<std::string>> buffers(pool.Size());
+        auto sink = [&buffers, budget](size_t worker, const fs::path &path, bool)
+        {
+            if (!budget->Claim())
+            {
+                return false;
+            }
+            buffers[worker].push_back(path.string());
+            return !budget->Full();
+        };
+        traverse_parallel(root, patterns, std::move(states), type, pool, sink, stop, silence, callback, budget, scope);
+        for (auto &buffer : buffers)
+        {
+            results.insert(results.end(), std::make_move_iterator(buffer.begin()), std::make_move_iterator(buffer.end()));
+        }
+        return false;
+    }
+
+    struct FindGroup
+    {
+        std::string root;
+        std::vector<std::string> root_parts;
+        std::vector<SearchState> states;
+    };
+
+    // 解析后的查找计划: direct 为无需遍历即可确定的路径, 其余按根目录分组
+    struct FindPlan
+    {
+        std::vector<std::string> direct;
+        std::vector<std::vector<AMPathTools::PatternPtr>> patterns;
+        // 每个模式自身的根目录相对所在分组根目录的层数
+        std::vector<size_t> depths;
+        std::vector<FindGroup> groups;
+    };
+
+    FindPlan plan_find(const std::vector<std::string> &paths, bool use_regex, CB callback, bool ignore_case = AMPathTools::DefaultIgnoreCase)
+    {
+        FindPlan plan;
+        std::vector<std::tuple<std::vector<std::string>, std::string, std::vector<AMPathTools::PatternPtr>>> parsed;
+        for (auto &path_f : paths)
+        {
+            if (fs::exists(path_f) && !use_regex)
+            {
+                plan.direct.push_back(path_f);
+                continue;
+            }
+            auto [match_parts, root_path, is_recursive] = preprocess(path_f, use_regex, ignore_case);
+            if (root_path.empty())
+            {
+                if (callback)
+                {
+                    (*callback)(path_f, "FailToParsingRoot", "Parsed Root is Empty");
+                }
+                continue;
+            }
+            if (!fs::exists(root_path))
+            {
+                continue;
+            }
+            if (match_parts.empty())
+            {
+                plan.direct.push_back(root_path);
+                continue;
+            }
+            bool is_valid = true;
+            for (auto &part : match_parts)
+            {
+                if (!part->IsValid())
+                {
+                    if (callback)
+                    {
+                        (*callback)(path_f, part->GetKind() == AMPathTools::CompiledPattern::Kind::Regex ? "RegexSytanxError" : "PatternSyntaxError", part->GetError());
+                    }
+                    is_valid = false;
+                    break;
+                }
+            }
+            if (is_valid)
+            {
+                parsed.emplace_back(AMPath::split(root_path), root_path, match_parts);
+            }
+        }
+
+        // 按根目录分组, 根目录位于其他根之下的模式改写为从上层根出发的字面量段
+        std::stable_sort(parsed.begin(), parsed.end(), [](const auto &a, const auto &b)
+                         { return std::get<0>(a).size() < std::get<0>(b).size(); });
+        for (auto &[root_parts, root_path, match_parts] : parsed)
+        {
+            FindGroup *owner = nullptr;
+            for (auto &group : plan.groups)
+            {
+                if (group.root_parts.size() <= root_parts.size() && std::equal(group.root_parts.begin(), group.root_parts.end(), root_parts.begin()))
+                {
+                    owner = &group;
+                    break;
+                }
+            }
+            std::vector<AMPathTools::PatternPtr> parts;
+            plan.depths.push_back(owner ? root_parts.size() - owner->root_parts.size() : 0);
+            if (owner)
+            {
+                for (size_t i = owner->root_parts.size(); i < root_parts.size(); i++)
+                {
+                    parts.push_back(AMPathTools::GetCompiledPattern(AMPathTools::AMutf8(root_parts[i]), false, ignore_case));
+                }
+            }
+            else
+            {
+                std::string root = root_path;
+                if (root.find("\\") == std::string::npos && root.find("/") == std::string::npos)
+                {
+                    root = root + PreferredSep;
+                }
+                plan.groups.push_back({root, root_parts, {}});
+                owner = &plan.groups.back();
+            }
+            parts.insert(parts.end(), match_parts.begin(), match_parts.end());
+            owner->states.push_back({plan.patterns.size(), 0});
+            plan.patterns.push_back(parts);
+        }
+        return plan;
+    }
+
+    struct FindResult
+    {
+        std::vector<std::string> paths;
+        FindStatus status = FindStatus::Complete;
+    };
+
+    // 带限制的查找, 达到限制后返回已找到的部分结果, status 说明停止的原因
+    // threads 为 0 时使用硬件线程数; 多线程时结果顺序不确定, sorted 为 true 时排序后返回
+    FindResult find(const std::vector<std::string> &paths, const FindLimits &limits, AMPathTools::ENUMS::SearchType type = AMPathTools::ENUMS::SearchType::All, bool use_regex = false, bool silence = false, CB callback = nullptr, size_t threads = 1, bool sorted = false)
+    {
+        FindPlan plan = plan_find(paths, use_regex, callback, limits.ignore_case);
+        TraverseBudget budget(limits, plan.depths);
+        FindResult result;
+        for (auto &path : plan.direct)
+        {
+            if (!budget.Claim())
+            {
+                break;
+            }
+            result.paths.push_back(path);
+        }
+        for (auto &group : plan.groups)
+        {
+            if (budget.GetStatus() != FindStatus::Complete)
+            {
+                break;
+            }
+            fs::path root(group.root);
+            budget.ResetDirs();
+            search_states(result.paths, root, plan.patterns, group.states, type, silence, callback, threads, &budget, AMPathTools::IgnoreScope::Root(limits.exclude, root, limits.read_gitignore));
+        }
+        result.status = budget.GetStatus();
+        if (sorted)
+        {
+            std::sort(result.paths.begin(), result.paths.end());
+        }
+        return result;
+    }
+
+    std::vector<std::string> find(const std::vector<std::string> &paths, AMPathTools::ENUMS::SearchType type = AMPathTools::ENUMS::SearchType::All, bool use_regex = false, bool silence = false, CB callback = nullptr, size_t threads = 1, bool sorted = false)
+    {
+        return find(paths, FindLimits{}, type, use_regex, silence, callback, threads, sorted).paths;
+    }
+
+    // 每找到一个路径立即交给 sink, 不保留完整结果; sink 返回 false 时停止查找, 此时状态为 Cancelled
+    // 多线程时 sink 与 callback 会被加锁串行调用, 但顺序不确定
+    FindStatus find_each(const std::vector<std::string> &paths, const std::function<bool(const std::string &)> &sink, const FindLimits &limits, AMPathTools::ENUMS::SearchType type = AMPathTools::ENUMS::SearchType::All, bool use_regex = false, bool silence = false, CB callback = nullptr, size_t threads = 1)
+    {
+        FindPlan plan = plan_find(paths, use_regex, callback, limits.ignore_case);
+        TraverseBudget budget(limits, plan.depths);
+        auto accept = [&](const std::string &path)
+        {
+            if (!budget.Claim())
+            {
+                return false;
+            }
+            if (!sink(path))
+            {
+                budget.Halt(FindStatus::Cancelled);
+                return false;
+            }
+            return !budget.Full();
+        };
+        for (auto &path : plan.direct)
+        {
+            if (!accept(path))
+            {
+                return budget.GetStatus();
+            }
+        }
+        std::atomic<bool> stop = false;
+        std::mutex sink_mutex;
+        for (auto &group : plan.groups)
+        {
+            fs::path root(group.root);
+            AMPathTools::IgnoreScope scope = AMPathTools::IgnoreScope::Root(limits.exclude, root, limits.read_gitignore);
+            budget.ResetDirs();
+            if (threads == 1)
+            {
+                auto serial_sink = [&accept](const fs::path &path, bool)
+                {
+                    return accept(path.string());
+                };
+                traverse(root, plan.patterns, group.states, type, serial_sink, stop, silence, callback, &budget, 0, scope);
+            }
+            else
+            {
+                AMPathTools::WorkPool pool(threads);
+                auto locked_sink = [&](size_t, const fs::path &path, bool)
+                {
+                    std::string cur_path = path.string();
+                    std::lock_guard<std::mutex> lock(sink_mutex);
+                    return accept(cur_path);
+                };
+                traverse_parallel(root, plan.patterns, group.states, type, pool, locked_sink, stop, silence, callback, &budget, scope);
+            }
+            if (stop)
+            {
+                break;
+            }
+        }
+        return budget.GetStatus();
+    }
+
+    // 不带限制的版本, sink 要求停止时返回 false
+    bool find_each(const std::vector<std::string> &paths, const std::function<bool(const std::string &)> &sink, AMPathTools::ENUMS::SearchType type = AMPathTools::ENUMS::SearchType::All, bool use_regex = false, bool silence = false, CB callback = nullptr, size_t threads = 1)
+    {
+        return find_each(paths, sink, FindLimits{}, type, use_regex, silence, callback, threads) == FindStatus::Complete;
+    }
+
+    // 拉取式的查找: 后台线程遍历并写入有界队列, 调用方用 Next 逐个取出;
+    // 消费跟不上时遍历线程阻塞等待, 内存占用不超过 capacity 条路径; callback 在后台线程调用
+    class FindStream
+    {
+    public:
+        FindStream(const std::vector<std::string> &paths, AMPathTools::ENUMS::SearchType type = AMPathTools::ENUMS::SearchType::All, bool use_regex = false, bool silence = false, CB callback = nullptr, size_t threads = 1, size_t capacity = 1024, const FindLimits &limits = {}) : queue(capacity)
+        {
+            producer = std::thread([this, paths, type, use_regex, silence, callback, threads, limits]()
+                                   {
+                                       try
+                                       {
+                                           status = find_each(paths, [this](const std::string &path)
+                                                              { return queue.Push(path); },
+                                                              limits, type, use_regex, silence, callback, threads);
+                                       }
+                                       catch (const std::exception &e)
+                                       {
+                                           if (callback)
+                                           {
+                                               (*callback)("", "FindFailed", e.what());
+                                           }
+                                       }
+                                       queue.Finish(); });
+        }
+
+        FindStream(const FindStream &) = delete;
+        FindStream &operator=(const FindStream &) = delete;
+
+        ~FindStream()
+        {
+            Close();
+        }
+
+        // 阻塞直到取得下一个路径; 查找结束且队列取空后返回 false
+        bool Next(std::string &path)
+        {
+            return queue.Pop(path);
+        }
+
+        // Next 返回 false 之后才有意义
+        FindStatus GetStatus() const
+        {
+            return status;
+        }
+
+        // 提前结束: 丢弃未取出的结果并等待后台线程退出
+        void Close()
+        {
+            queue.Cancel();
+            if (producer.joinable())
+            {
+                producer.join();
+            }
+        }
+
+    private:
+        AMPathTools::BoundedQueue<std::string> queue;
+        std::thread producer;
+        std::atomic<FindStatus> status = FindStatus::Complete;
+    };
+
+    void search(std::vector<std::string> &results, fs::path root, const std::vector<AMPathTools::PatternPtr> &parts, size_t index, AMPathTools::ENUMS::SearchType type, bool silence, CB callback)
+    {
+        if (index >= parts.size() || !fs::is_directory(root))
+        {
+            return;
+        }
+        search_states(results, root, {parts}, {{0, index}}, type, silence, callback);
+    }
+
+    FindResult find(const std::string &path_f, const FindLimits &limits, AMPathTools::ENUMS::SearchType type = AMPathTools::ENUMS::SearchType::All, bool use_regex = false, bool silence = false, CB callback = nullptr, size_t threads = 1, bool sorted = false)
+    {
+        return find(std::vector<std::string>{path_f}, limits, type, use_regex, silence, callback, threads, sorted);
+    }
+
+    std::vector<std::string> find(const std::string &path_f, AMPathTools::ENUMS::SearchType type = AMPathTools::ENUMS::SearchType::All, bool use_regex = false, bool silence = false, CB callback = nullptr, size_t threads = 1, bool sorted = false)
+    {
+        return find(std::vector<std::string>{path_f}, type, use_regex, silence, callback, threads, sorted);
     }
 }
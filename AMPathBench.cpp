@@ -0,0 +1,957 @@
+#include "AMPathMatch.hpp"
+#include <chrono>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "AMPath.hpp"
+#include "AMPathSearch.hpp"
+#include <algorithm>
+#include <thread>
+
+namespace AMPathBench
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<std::string> MakeNames(size_t count)
+    {
+        const std::vector<std::string> exts = {".log", ".txt", ".csv", ".tmp", ".bin"};
+        const std::vector<std::string> heads = {"report_", "data_", "build_", "img_", "note_", "Отчёт_"};
+        std::vector<std::string> names;
+        names.reserve(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            names.push_back(fmt::format("{}{}_{}{}", heads[i % heads.size()], 2020 + i % 7, i, exts[(i / 3) % exts.size()]));
+        }
+        return names;
+    }
+
+    template <typename Func>
+    double Time(Func &&func, size_t &hits)
+    {
+        auto start = Clock::now();
+        hits = func();
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    void MatchBench(const std::vector<std::string> &names, const std::string &pattern, bool use_regex)
+    {
+        auto run = [&](bool ignore_case)
+        {
+            AMPathTools::CompiledPattern compiled(pattern, use_regex, ignore_case);
+            size_t hits = 0;
+            for (auto &name : names)
+            {
+                hits += compiled.Match(name);
+            }
+            return hits;
+        };
+        size_t hits = 0;
+        size_t fold_hits = 0;
+        double ms = Time([&]()
+                         { return run(false); },
+                         hits);
+        double fold_ms = Time([&]()
+                              { return run(true); },
+                              fold_hits);
+        AMPathTools::CompiledPattern compiled(pattern, use_regex, false);
+        size_t passed = 0;
+        for (auto &name : names)
+        {
+            passed += compiled.Prefilter(name);
+        }
+        std::string line = fmt::format("{:<24} CompiledPattern: {:>8.2f} ms ({:>6} hits)  ignore case: {:>8.2f} ms ({:>6} hits)  prefilter pass: {}",
+                                       pattern, ms, hits, fold_ms, fold_hits, passed);
+        size_t old_hits = 0;
+        double old_ms = Time([&]()
+                             {
+                                 size_t hits = 0;
+                                 for (auto &name : names)
+                                 {
+                                     hits += AMPathTools::_match(name, pattern, use_regex);
+                                 }
+                                 return hits; },
+                             old_hits);
+        line += fmt::format("  _match: {:.2f} ms ({} hits)", old_ms, old_hits);
+        std::cout << line << std::endl;
+    }
+
+    void CacheBench(size_t rounds)
+    {
+        const std::vector<std::string> patterns = {"*.log", "report_*", "*_2025*.csv", "<^img_\\d+$", "**"};
+        size_t hits = 0;
+        double raw_ms = Time([&]()
+                             {
+                                 size_t valid = 0;
+                                 for (size_t i = 0; i < rounds; i++)
+                                 {
+                                     AMPathTools::CompiledPattern compiled(patterns[i % patterns.size()], true);
+                                     valid += compiled.IsValid();
+                                 }
+                                 return valid; },
+                             hits);
+        AMPathTools::GetPatternCache().Clear();
+        double cache_ms = Time([&]()
+                               {
+                                   size_t valid = 0;
+                                   for (size_t i = 0; i < rounds; i++)
+                                   {
+                                       valid += AMPathTools::GetCompiledPattern(patterns[i % patterns.size()], true)->IsValid();
+                                   }
+                                   return valid; },
+                               hits);
+        auto &cache = AMPathTools::GetPatternCache();
+        std::cout << fmt::format("compile x{}: {:.2f} ms  cached: {:.2f} ms  (hits {}, misses {})",
+                                 rounds, raw_ms, cache_ms, cache.GetHits(), cache.GetMisses())
+                  << std::endl;
+    }
+
+    namespace fs = std::filesystem;
+    using Parts = std::vector<AMPathTools::PatternPtr>;
+
+    // 旧版 AMPath::search 的递归方式, 只保留用于对比; io 按与 AMPath::IOCounters 相同的口径统计
+    void LegacySearch(std::vector<std::string> &results, const fs::path &root, const Parts &parts, size_t index, AMPath::IOStats &io)
+    {
+        const AMPathTools::CompiledPattern &name = *parts[index];
+        io.stats++;
+        if (!fs::is_directory(root))
+        {
+            if (index + 1 == parts.size() && name.Match(root.filename().string()))
+            {
+                results.push_back(root.string());
+            }
+            return;
+        }
+        io.dir_opens++;
+        for (auto &entry : fs::directory_iterator(root))
+        {
+            std::string cur_name = entry.path().filename().string();
+            io.entries++;
+            io.stats++;
+            bool is_dir = fs::is_directory(entry.path());
+            if (index + 1 == parts.size())
+            {
+                if (name.IsRecursive())
+                {
+                    if (is_dir)
+                    {
+                        io.stats++;
+                        io.dir_opens++;
+                    }
+                    if (!is_dir || fs::is_empty(entry.path()))
+                    {
+                        results.push_back(entry.path().string());
+                    }
+                    else
+                    {
+                        LegacySearch(results, entry.path(), parts, index, io);
+                    }
+                }
+                else if (name.Match(cur_name))
+                {
+                    results.push_back(entry.path().string());
+                }
+                continue;
+            }
+            if (name.IsRecursive())
+            {
+                bool next_match = parts[index + 1]->Match(cur_name);
+                if (is_dir)
+                {
+                    LegacySearch(results, entry.path(), parts, index, io);
+                    if (next_match)
+                    {
+                        LegacySearch(results, entry.path(), parts, index + 1, io);
+                    }
+                }
+                else if (next_match)
+                {
+                    results.push_back(entry.path().string());
+                }
+                continue;
+            }
+            LegacySearch(results, entry.path(), parts, index, io);
+            if (name.Match(cur_name))
+            {
+                LegacySearch(results, entry.path(), parts, index + 1, io);
+            }
+        }
+    }
+
+    // 每层目录都包含 a/b/c 三个子目录和若干文件, 深度为 depth
+    void MakeTree(const fs::path &root, int depth, int files)
+    {
+        fs::create_directories(root);
+        for (int i = 0; i < files; i++)
+        {
+            std::ofstream(root / fmt::format("f{}.txt", i));
+        }
+        if (depth == 0)
+        {
+            return;
+        }
+        for (auto sub : {"a", "b", "c"})
+        {
+            MakeTree(root / sub, depth - 1, files);
+        }
+    }
+
+    void TreeBench(int depth, const std::string &pattern)
+    {
+        fs::path root = fs::temp_directory_path() / "ampath_bench_tree";
+        fs::remove_all(root);
+        MakeTree(root, depth, 4);
+
+        Parts parts;
+        std::string rest = pattern;
+        while (!rest.empty())
+        {
+            size_t pos = rest.find('/');
+            parts.push_back(AMPathTools::GetCompiledPattern(rest.substr(0, pos), false));
+            rest = pos == std::string::npos ? "" : rest.substr(pos + 1);
+        }
+
+        AMPath::IOStats legacy_io;
+        size_t legacy_hits = 0;
+        size_t new_hits = 0;
+        double legacy_ms = Time([&]()
+                                {
+                                    std::vector<std::string> results;
+                                    LegacySearch(results, root, parts, 0, legacy_io);
+                                    return results.size(); },
+                                legacy_hits);
+        std::vector<std::string> serial;
+        std::vector<std::string> parallel;
+        AMPath::GetIOCounters().Reset();
+        double new_ms = Time([&]()
+                             {
+                                 AMPath::search(serial, root, parts, 0, AMPathTools::ENUMS::SearchType::All, true, nullptr);
+                                 return serial.size(); },
+                             new_hits);
+        AMPath::IOStats new_io = AMPath::GetIOCounters().Snapshot();
+        size_t par_hits = 0;
+        size_t threads = std::max(4u, std::thread::hardware_concurrency());
+        double par_ms = Time([&]()
+                             {
+                                 AMPath::search_states(parallel, root, {parts}, {{0, 0}}, AMPathTools::ENUMS::SearchType::All, true, nullptr, threads);
+                                 return parallel.size(); },
+                             par_hits);
+        std::sort(serial.begin(), serial.end());
+        std::sort(parallel.begin(), parallel.end());
+        std::cout << fmt::format("tree depth {} {:<20} legacy: {:>9.2f} ms ({} hits)  state walk: {:>9.2f} ms ({} hits)  x{:.1f}  {} threads: {:>9.2f} ms ({} hits, {})",
+                                 depth, pattern, legacy_ms, legacy_hits, new_ms, new_hits, new_ms > 0 ? legacy_ms / new_ms : 0.0,
+                                 threads, par_ms, par_hits, serial == parallel ? "same" : "DIFFERENT")
+                  << std::endl;
+        std::cout << fmt::format("    io legacy: {} dir opens, {} entries, {} stats  state walk: {} dir opens, {} entries, {} stats, {} probes",
+                                 legacy_io.dir_opens, legacy_io.entries, legacy_io.stats, new_io.dir_opens, new_io.entries, new_io.stats, new_io.probes)
+                  << std::endl;
+        fs::remove_all(root);
+    }
+
+    // find 要等遍历结束才返回, FindStream 在遍历过程中就能取到第一个结果
+    void StreamBench(int depth, const std::string &pattern)
+    {
+        fs::path root = fs::temp_directory_path() / "ampath_bench_stream";
+        fs::remove_all(root);
+        MakeTree(root, depth, 4);
+        std::string path = (root / pattern).string();
+
+        auto start = Clock::now();
+        auto results = AMPath::find(path, AMPathTools::ENUMS::SearchType::All, false, true);
+        double find_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        start = Clock::now();
+        double first_ms = 0;
+        size_t count = 0;
+        {
+            AMPath::FindStream stream({path}, AMPathTools::ENUMS::SearchType::All, false, true, nullptr, 1, 256);
+            std::string cur;
+            while (stream.Next(cur))
+            {
+                if (count++ == 0)
+                {
+                    first_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+                }
+            }
+        }
+        double stream_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        std::cout << fmt::format("stream {:<16} find: {:>9.2f} ms ({} paths)  FindStream first path: {:>8.3f} ms  all: {:>9.2f} ms ({} paths)",
+                                 pattern, find_ms, results.size(), first_ms, stream_ms, count)
+                  << std::endl;
+        fs::remove_all(root);
+    }
+
+    // 旧版 getsize 的逐项判断方式, 与单线程 / 多线程的 getsize_info 对比
+    uint64_t LegacyGetsize(const fs::path &p)
+    {
+        uint64_t result = 0;
+        if (!fs::exists(p))
+        {
+            return result;
+        }
+        if (fs::is_directory(p))
+        {
+            for (const auto &entry : fs::directory_iterator(p))
+            {
+                result += LegacyGetsize(entry.path());
+            }
+        }
+        else if (fs::is_regular_file(p))
+        {
+            result += fs::file_size(p);
+        }
+        return result;
+    }
+
+    // 文件写入已知长度, 另有一个文件带一个硬链接; 校验去重与不去重时的精确总量
+    void SizeBench(int depth)
+    {
+        fs::path root = fs::temp_directory_path() / "ampath_bench_size";
+        fs::remove_all(root);
+        MakeTree(root, depth, 4);
+        uint64_t expect = 0;
+        size_t index = 0;
+        for (auto &entry : fs::recursive_directory_iterator(root))
+        {
+            if (entry.is_regular_file())
+            {
+                size_t length = (index++ % 5 + 1) * 1000;
+                std::ofstream(entry.path(), std::ios::binary) << std::string(length, 'x');
+                expect += length;
+            }
+        }
+        const uint64_t linked = 100000;
+        std::ofstream(root / "a" / "linked.bin", std::ios::binary) << std::string(linked, 'y');
+        fs::create_hard_link(root / "a" / "linked.bin", root / "b" / "linked_2.bin");
+        uint64_t expect_dedup = expect + linked;
+        uint64_t expect_all = expect + 2 * linked;
+
+        size_t legacy = 0;
+        double legacy_ms = Time([&]()
+                                { return static_cast<size_t>(LegacyGetsize(root)); },
+                                legacy);
+        AMPath::SizeInfo serial;
+        size_t hits = 0;
+        double serial_ms = Time([&]()
+                                { serial = AMPath::getsize_info(root.string(), false, true, 1);
+                                  return serial.files; },
+                                hits);
+        size_t threads = std::max<size_t>(4, std::thread::hardware_concurrency());
+        AMPath::SizeInfo parallel;
+        double parallel_ms = Time([&]()
+                                  { parallel = AMPath::getsize_info(root.string(), false, true, threads);
+                                    return parallel.files; },
+                                  hits);
+        AMPath::SizeInfo all = AMPath::getsize_info(root.string(), false, false, threads);
+        std::cout << fmt::format("getsize depth {} ({} files, {} dirs)  legacy: {:>8.2f} ms  getsize_info: {:>8.2f} ms  {} threads: {:>8.2f} ms",
+                                 depth, serial.files, serial.dirs, legacy_ms, serial_ms, threads, parallel_ms)
+                  << std::endl;
+
+        auto check = [](bool ok, const std::string &what, uint64_t expect, uint64_t got)
+        {
+            std::cout << fmt::format("{:<4} getsize {:<32} expect {:>10}  got {:>10}", ok ? "OK" : "FAIL", what, expect, got) << std::endl;
+        };
+        check(serial.apparent == expect_dedup, "apparent (dedup)", expect_dedup, serial.apparent);
+        check(parallel.apparent == expect_dedup && parallel.allocated == serial.allocated, "apparent (dedup, threads)", expect_dedup, parallel.apparent);
+        check(serial.hardlinks == 1, "hardlinks skipped", 1, serial.hardlinks);
+        check(all.apparent == expect_all, "apparent (no dedup)", expect_all, all.apparent);
+        check(all.apparent - serial.apparent == linked, "dedup difference", linked, all.apparent - serial.apparent);
+        check(legacy == expect_all, "legacy apparent", expect_all, legacy);
+        // 没有稀疏文件时占用空间不小于文件长度
+        check(serial.allocated >= serial.apparent, "allocated >= apparent (dedup)", serial.apparent, serial.allocated);
+        check(all.allocated >= all.apparent, "allocated >= apparent (no dedup)", all.apparent, all.allocated);
+        fs::remove_all(root);
+
+        // 并行按目录分发, 上面的小树调度开销占主导; 宽而大的树才能体现多线程的收益
+        fs::path wide = fs::temp_directory_path() / "ampath_bench_size_wide";
+        fs::remove_all(wide);
+        const size_t wide_dirs = 256;
+        const size_t wide_files = 400;
+        for (size_t d = 0; d < wide_dirs; d++)
+        {
+            fs::path dir = wide / fmt::format("d{}", d);
+            fs::create_directories(dir);
+            for (size_t f = 0; f < wide_files; f++)
+            {
+                std::ofstream(dir / fmt::format("f{}.txt", f), std::ios::binary) << 'x';
+            }
+        }
+        uint64_t wide_serial = 0;
+        double wide_serial_ms = Time([&]()
+                                     { wide_serial = AMPath::getsize(wide.string(), false, 1);
+                                       return static_cast<size_t>(wide_serial); },
+                                     hits);
+        uint64_t wide_parallel = 0;
+        double wide_parallel_ms = Time([&]()
+                                       { wide_parallel = AMPath::getsize(wide.string(), false, threads);
+                                         return static_cast<size_t>(wide_parallel); },
+                                       hits);
+        std::cout << fmt::format("getsize wide ({} dirs x {} files, {} hardware threads)  serial: {:>8.2f} ms  {} threads: {:>8.2f} ms  speedup {:.2f}x",
+                                 wide_dirs, wide_files, std::thread::hardware_concurrency(), wide_serial_ms, threads, wide_parallel_ms, wide_serial_ms / wide_parallel_ms)
+                  << std::endl;
+        check(wide_serial == wide_dirs * wide_files && wide_parallel == wide_serial, "wide tree (getsize, threads)", wide_dirs * wide_files, wide_parallel);
+        fs::remove_all(wide);
+    }
+
+    // 完整遍历 / 首次写快照 / 目录未变时从快照读取
+    void SnapshotBench(int depth)
+    {
+        fs::path root = fs::temp_directory_path() / "ampath_bench_snapshot";
+        std::string snapshot = (fs::temp_directory_path() / "ampath_bench_snapshot.snap").string();
+        fs::remove_all(root);
+        fs::remove(snapshot);
+        MakeTree(root, depth, 4);
+        // 刚修改过的目录不会被信任, 等过了时间粒度再记录
+        std::this_thread::sleep_for(std::chrono::milliseconds(2100));
+        AMPath::WalkOptions options;
+        auto count_all = [&](const AMPath::WalkOptions &opt)
+        {
+            size_t count = 0;
+            AMPath::walk_each(root.string(), [&count](std::vector<AMPath::PathInfo> &batch)
+                              { count += batch.size();
+                                return true; },
+                              opt);
+            return count;
+        };
+        size_t plain = 0;
+        double plain_ms = Time([&]()
+                               { return count_all(options); },
+                               plain);
+        options.snapshot = snapshot;
+        size_t first = 0;
+        double first_ms = Time([&]()
+                               { return count_all(options); },
+                               first);
+        size_t changes = 0;
+        options.on_change = [&changes](const AMPath::WalkChange &)
+        { changes++; };
+        size_t second = 0;
+        double second_ms = Time([&]()
+                                { return count_all(options); },
+                                second);
+        std::cout << fmt::format("walk depth {} ({} entries)  plain: {:>8.2f} ms  write snapshot: {:>8.2f} ms ({} entries, {} bytes)  from snapshot: {:>8.2f} ms ({} entries, {} changes)",
+                                 depth, plain, plain_ms, first_ms, first, fs::file_size(snapshot), second_ms, second, changes)
+                  << std::endl;
+
+        // 时间粒度内刚修改的目录: 报告一次新增, 之后重新枚举但不再报告, 过了粒度后直接取自快照
+        auto run = [&](uint64_t &opens)
+        {
+            changes = 0;
+            AMPath::GetIOCounters().Reset();
+            count_all(options);
+            opens = AMPath::GetIOCounters().Snapshot().dir_opens;
+            return changes;
+        };
+        std::ofstream(root / "a" / "touched.txt");
+        uint64_t opens[4] = {};
+        size_t touched = run(opens[0]);
+        size_t again = run(opens[1]);
+        uint64_t dir_mtime = 0;
+        AMPathTools::get_dir_mtime(root / "a", dir_mtime);
+        std::this_thread::sleep_for(std::chrono::nanoseconds(AMPathTools::mtime_granularity(dir_mtime)) + std::chrono::milliseconds(50));
+        size_t settled = run(opens[2]);
+        size_t served = run(opens[3]);
+        bool ok = touched == 1 && again == 0 && opens[1] >= 1 && settled == 0 && served == 0 && opens[3] == 0;
+        std::cout << fmt::format("{:<4} snapshot touched dir  changes {} / {} / {} / {}  dirs read {} / {} / {} / {}",
+                                 ok ? "OK" : "FAIL", touched, again, settled, served, opens[0], opens[1], opens[2], opens[3])
+                  << std::endl;
+
+        // 上次被剪枝的目录没有记录, 但也不是新目录, 其内容不应报告为新增
+        options.prune = [&root](const AMPath::PathInfo &dir)
+        { return fs::path(dir.path) == root / "b"; };
+        size_t pruned = run(opens[0]);
+        options.prune = nullptr;
+        size_t unpruned = run(opens[1]);
+        ok = pruned == 0 && unpruned == 0;
+        std::cout << fmt::format("{:<4} snapshot pruned dir  changes {} / {}", ok ? "OK" : "FAIL", pruned, unpruned) << std::endl;
+        fs::remove_all(root);
+        fs::remove(snapshot);
+    }
+
+    // 各字段单独请求时 listdir 的耗时, 类型总会计算
+    void StatBench(size_t files)
+    {
+        fs::path root = fs::temp_directory_path() / "ampath_bench_stat";
+        fs::remove_all(root);
+        fs::create_directories(root);
+        for (size_t i = 0; i < files; i++)
+        {
+            std::ofstream(root / fmt::format("file_{:06}.txt", i)) << i;
+        }
+        const std::vector<std::pair<std::string, uint32_t>> masks = {
+            {"type only", 0},
+            {"STAT_NAME", AMPath::STAT_NAME},
+            {"STAT_SIZE", AMPath::STAT_SIZE},
+            {"STAT_TIMES", AMPath::STAT_TIMES},
+            {"STAT_OWNER", AMPath::STAT_OWNER},
+            {"STAT_MODE", AMPath::STAT_MODE},
+            {"STAT_NAME|STAT_SIZE", AMPath::STAT_NAME | AMPath::STAT_SIZE},
+            {"STAT_ALL", AMPath::STAT_ALL},
+        };
+        for (auto &[label, mask] : masks)
+        {
+            size_t count = 0;
+            uint32_t fields = mask;
+            // 属主缓存每轮清空, 记录实际的属主查询次数
+            AMPathTools::GetOwnerCache().Clear();
+            double ms = Time([&]()
+                             { return AMPath::listdir(root.string(), fields).size(); },
+                             count);
+            std::cout << fmt::format("listdir {} entries  {:<20} {:>8.2f} ms  owner lookups: {}", count, label, ms, AMPathTools::GetOwnerCache().GetMisses()) << std::endl;
+        }
+        fs::remove_all(root);
+    }
+
+    // 旧版 stat 对每个条目分别取类型, 大小与时间; 与 listdir 的单次元数据调用比较调用次数, 两边都不拼接路径
+    void MetaBench(size_t files)
+    {
+        fs::path root = fs::temp_directory_path() / "ampath_bench_meta";
+        fs::remove_all(root);
+        fs::create_directories(root);
+        for (size_t i = 0; i < files; i++)
+        {
+            std::ofstream(root / fmt::format("file_{:06}.txt", i)) << i;
+        }
+        size_t legacy_calls = 0;
+        size_t legacy_count = 0;
+        double legacy_ms = Time([&]()
+                                {
+                                    size_t count = 0;
+                                    uint64_t total = 0;
+                                    for (auto &entry : fs::directory_iterator(root))
+                                    {
+                                        std::error_code ec;
+                                        fs::file_status status = fs::symlink_status(entry.path(), ec);
+                                        legacy_calls++;
+                                        if (fs::is_regular_file(status))
+                                        {
+                                            total += fs::file_size(entry.path(), ec);
+                                            legacy_calls++;
+                                        }
+                                        total += fs::last_write_time(entry.path(), ec).time_since_epoch().count() & 1;
+                                        legacy_calls++;
+                                        count++;
+                                    }
+                                    return count + (total & 0); },
+                                legacy_count);
+        AMPath::GetIOCounters().Reset();
+        size_t count = 0;
+        double ms = Time([&]()
+                         { return AMPath::listdir(root.string(), AMPath::STAT_SIZE | AMPath::STAT_TIMES | AMPath::STAT_MODE).size(); },
+                         count);
+        uint64_t calls = AMPath::GetIOCounters().Snapshot().stats;
+        std::cout << fmt::format("metadata {} entries  per-field calls: {:>8.2f} ms ({} calls)  listdir: {:>8.2f} ms ({} calls, x{:.1f} fewer)",
+                                 count, legacy_ms, legacy_calls, ms, calls, calls ? static_cast<double>(legacy_calls) / calls : 0.0)
+                  << std::endl;
+        fs::remove_all(root);
+    }
+
+    // 单个大目录的批量 stat: io_uring, 逐个 statx, 线程池三种后端
+    void BatchBench(size_t files)
+    {
+        fs::path root = fs::temp_directory_path() / "ampath_bench_batch";
+        fs::remove_all(root);
+        fs::create_directories(root);
+        for (size_t i = 0; i < files; i++)
+        {
+            std::ofstream(root / fmt::format("file_{:06}.txt", i));
+        }
+        auto run = [&](size_t threads, bool use_ring)
+        {
+            size_t ok = 0;
+            AMPathTools::DirEnumerator dir(root);
+            AMPathTools::StatBatch batch(dir, false, threads, use_ring);
+            AMPathTools::DirEntry entry;
+            while (dir.Next(entry))
+            {
+                batch.Add(entry);
+            }
+            batch.Run();
+            for (size_t i = 0; i < batch.Size(); i++)
+            {
+                ok += batch.Ok(i);
+            }
+            return ok;
+        };
+        // 先完整跑一遍, 三种后端都在热缓存上比较
+        run(1, false);
+        size_t ring_ok = 0;
+        size_t serial_ok = 0;
+        size_t pool_ok = 0;
+        double serial_ms = Time([&]()
+                                { return run(1, false); },
+                                serial_ok);
+        double ring_ms = Time([&]()
+                              { return run(1, true); },
+                              ring_ok);
+        double pool_ms = Time([&]()
+                              { return run(0, false); },
+                              pool_ok);
+#ifdef AM_HAS_IO_URING
+        bool ring = AMPathTools::StatxRing::Local() != nullptr;
+#else
+        bool ring = false;
+#endif
+        std::cout << fmt::format("batch stat {} entries  serial: {:>8.2f} ms  io_uring{}: {:>8.2f} ms  pool: {:>8.2f} ms  ({}/{}/{} ok)",
+                                 files, serial_ms, ring ? "" : " (unavailable)", ring_ms, pool_ms, serial_ok, ring_ok, pool_ok)
+                  << std::endl;
+        fs::remove_all(root);
+    }
+
+    // walk 的结果: std::vector<PathInfo> 与按列存储的 PathInfoTable 的耗时和内存
+    void TableBench(int depth)
+    {
+        fs::path root = fs::temp_directory_path() / "ampath_bench_table";
+        fs::remove_all(root);
+        MakeTree(root, depth, 4);
+        size_t rows = 0;
+        size_t vector_bytes = 0;
+        double vector_ms = Time([&]()
+                                {
+                                    auto infos = AMPath::walk(root.string(), false, false);
+                                    vector_bytes = infos.capacity() * sizeof(AMPath::PathInfo);
+                                    for (auto &info : infos)
+                                    {
+                                        vector_bytes += info.name.capacity() + info.path.capacity() + info.dir.capacity() + info.uname.capacity() + info.mode_str.capacity();
+                                    }
+                                    return infos.size(); },
+                                rows);
+        size_t table_rows = 0;
+        size_t table_bytes = 0;
+        double table_ms = Time([&]()
+                               {
+                                   auto table = AMPath::walk_table(root.string());
+                                   table_bytes = table.MemoryUsage();
+                                   return table.Size(); },
+                               table_rows);
+        std::cout << fmt::format("walk result depth {}  vector<PathInfo>: {:>8.2f} ms {:>8.2f} MB  PathInfoTable: {:>8.2f} ms {:>8.2f} MB  ({}/{} rows, x{:.1f} smaller)",
+                                 depth, vector_ms, vector_bytes / 1048576.0, table_ms, table_bytes / 1048576.0, rows, table_rows,
+                                 table_bytes ? static_cast<double>(vector_bytes) / table_bytes : 0.0)
+                  << std::endl;
+        fs::remove_all(root);
+    }
+
+    // 源码树旁边放一个更大的 node_modules, 比较不排除与排除时的查找与统计
+    void ExcludeBench(int depth)
+    {
+        fs::path root = fs::temp_directory_path() / "ampath_bench_exclude";
+        fs::remove_all(root);
+        MakeTree(root / "src", depth, 4);
+        MakeTree(root / "node_modules", depth + 1, 4);
+        std::string pattern = (root / "**" / "*.txt").string();
+        AMPath::FindLimits limits;
+        size_t all = 0;
+        double all_ms = Time([&]()
+                             { return AMPath::find(pattern, limits).paths.size(); },
+                             all);
+        limits.exclude = AMPathTools::IgnoreRules::FromLines({"node_modules/"});
+        size_t kept = 0;
+        double kept_ms = Time([&]()
+                              { return AMPath::find(pattern, limits).paths.size(); },
+                              kept);
+        size_t files = 0;
+        double size_ms = Time([&]()
+                              { return AMPath::getsize_info(root.string(), false, true, 1).files; },
+                              files);
+        size_t kept_files = 0;
+        double kept_size_ms = Time([&]()
+                                   { return AMPath::getsize_info(root.string(), false, true, 1, limits.exclude).files; },
+                                   kept_files);
+        std::cout << fmt::format("exclude node_modules/ depth {}  find: {:>8.2f} ms ({} paths) -> {:>8.2f} ms ({} paths)  getsize: {:>8.2f} ms ({} files) -> {:>8.2f} ms ({} files)",
+                                 depth, all_ms, all, kept_ms, kept, size_ms, files, kept_size_ms, kept_files)
+                  << std::endl;
+        fs::remove_all(root);
+    }
+
+    // 排除规则的语义: find 与 walk 的结果必须与按 gitignore 语义写出的期望一致
+    void IgnoreConformanceBench()
+    {
+        fs::path root = fs::temp_directory_path() / "ampath_bench_ignore";
+        fs::remove_all(root);
+        fs::create_directories(root / "foo" / "sub");
+        fs::create_directories(root / "bar");
+        for (auto file : {"foo/keep", "foo/drop", "foo/sub/x", "bar/a{b", "bar/a}b", "bar/ab"})
+        {
+            std::ofstream(root / file);
+        }
+        // 规则, find "**" 的期望 (文件与空目录), walk 的期望
+        const std::vector<std::tuple<std::vector<std::string>, std::vector<std::string>, std::vector<std::string>>> cases = {
+            // 末尾的 ** 只匹配 foo 之内, foo 本身保留, keep 可以被重新包含
+            {{"foo/**", "!foo/keep"}, {"bar/a{b", "bar/a}b", "bar/ab", "foo/keep"}, {"bar", "bar/a{b", "bar/a}b", "bar/ab", "foo", "foo/keep"}},
+            // [] 内的 { } 是字面量
+            {{"a[{}]b"}, {"bar/ab", "foo/drop", "foo/keep", "foo/sub/x"}, {"bar", "bar/ab", "foo", "foo/drop", "foo/keep", "foo/sub", "foo/sub/x"}},
+        };
+        for (auto [lines, expect_find, expect_walk] : cases)
+        {
+            auto rules = AMPathTools::IgnoreRules::FromLines(lines);
+            AMPath::FindLimits limits;
+            limits.exclude = rules;
+            std::vector<std::string> found;
+            for (auto &path : AMPath::find((root / "**").string(), limits).paths)
+            {
+                found.push_back(fs::relative(path, root).generic_string());
+            }
+            AMPath::WalkOptions options;
+            options.exclude = rules;
+            std::vector<std::string> walked;
+            auto table = AMPath::walk_table(root.string(), options);
+            // 第一行是根目录自身
+            for (size_t i = 1; i < table.Size(); i++)
+            {
+                walked.push_back(fs::relative(table.Path(i), root).generic_string());
+            }
+            for (auto *paths : {&found, &walked, &expect_find, &expect_walk})
+            {
+                std::sort(paths->begin(), paths->end());
+            }
+            std::cout << fmt::format("{:<4} exclude {:<24} find {} paths  walk {} paths",
+                                     found == expect_find && walked == expect_walk ? "OK" : "FAIL", fmt::format("{}", fmt::join(lines, " ")), found.size(), walked.size())
+                      << std::endl;
+        }
+        fs::remove_all(root);
+    }
+
+    // 参照实现: 完整枚举整棵树, 再对相对路径逐段匹配, 只与解析共享代码
+    bool MatchSegments(const Parts &parts, size_t i, const std::vector<std::string> &segs, size_t j)
+    {
+        if (i == parts.size())
+        {
+            return j == segs.size();
+        }
+        if (parts[i]->IsRecursive())
+        {
+            for (size_t k = j; k <= segs.size(); k++)
+            {
+                if (MatchSegments(parts, i + 1, segs, k))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+        return j < segs.size() && parts[i]->Match(segs[j]) && MatchSegments(parts, i + 1, segs, j + 1);
+    }
+
+    std::vector<std::string> ReferenceFind(const std::string &pattern, bool use_regex)
+    {
+        auto [parts, root_path, is_recursive] = AMPath::preprocess(pattern, use_regex);
+        if (parts.empty())
+        {
+            return fs::exists(root_path) ? std::vector<std::string>{root_path} : std::vector<std::string>{};
+        }
+        std::vector<std::string> results;
+        bool tail = parts.back()->IsRecursive();
+        Parts head(parts.begin(), parts.end() - (tail ? 1 : 0));
+        for (auto &entry : fs::recursive_directory_iterator(root_path))
+        {
+            std::vector<std::string> segs;
+            for (auto &seg : fs::relative(entry.path(), root_path))
+            {
+                segs.push_back(AMPathTools::u8name(seg));
+            }
+            bool is_dir = fs::is_directory(entry.path());
+            bool hit = !tail && MatchSegments(parts, 0, segs, 0);
+            // 末尾的 ** 至少再匹配一层, 且只收集文件与空目录
+            if (tail && (!is_dir || fs::is_empty(entry.path())))
+            {
+                for (size_t k = 0; k < segs.size() && !hit; k++)
+                {
+                    hit = MatchSegments(head, 0, std::vector<std::string>(segs.begin(), segs.begin() + k), 0);
+                }
+            }
+            if (hit)
+            {
+                results.push_back(entry.path().string());
+            }
+        }
+        return results;
+    }
+
+    std::vector<std::string> Normalize(std::vector<std::string> paths)
+    {
+        for (auto &path : paths)
+        {
+            path = fs::path(path).lexically_normal().string();
+        }
+        std::sort(paths.begin(), paths.end());
+        return paths;
+    }
+
+    // 两个入口与参照实现的结果必须一致, 同时记录耗时
+    void ConformanceBench(int depth)
+    {
+        fs::path root = fs::temp_directory_path() / "ampath_bench_conformance";
+        fs::remove_all(root);
+        MakeTree(root, depth, 3);
+        fs::create_directories(root / "a" / "empty");
+        std::ofstream(root / "b" / fs::u8path("Отчёт_1.LOG"));
+        std::ofstream(root / "c" / "a" / "data_2024.csv");
+
+        const std::vector<std::pair<std::string, bool>> patterns = {
+            {"**/*.txt", false},
+            {"a/**/b/*", false},
+            {"*/b/**", false},
+            {"**/[ab]/f?.txt", false},
+            {"**/{a,c}/f[!0].txt", false},
+            {"**/c", false},
+            {"**", false},
+            {"a/b/f1.txt", false},
+            {"**/*_202[0-9].{csv,log}", false},
+            {"**/<^f[12]\\.txt$>", true},
+        };
+        for (auto &[pattern, use_regex] : patterns)
+        {
+            std::string path = (root / pattern).string();
+            std::vector<std::string> expect;
+            std::vector<std::string> got;
+            std::vector<std::string> legacy;
+            size_t hits = 0;
+            double ref_ms = Time([&]()
+                                 { expect = Normalize(ReferenceFind(path, use_regex));
+                                   return expect.size(); },
+                                 hits);
+            double find_ms = Time([&]()
+                                  { got = Normalize(AMPath::find(path, AMPathTools::ENUMS::SearchType::All, use_regex, true));
+                                    return got.size(); },
+                                  hits);
+            double legacy_ms = Time([&]()
+                                    {
+                                        auto result = AMPathSearch::find(path, AMPathSearch::SearchType::All, use_regex, true);
+                                        if (auto paths = std::get_if<std::vector<std::string>>(&result))
+                                        {
+                                            legacy = Normalize(*paths);
+                                        }
+                                        return legacy.size(); },
+                                    hits);
+            bool ok = got == expect && legacy == expect;
+            std::cout << fmt::format("{:<4} {:<28} {:>5} paths  reference: {:>8.2f} ms  AMPath::find: {:>8.2f} ms  AMPathSearch::find: {:>8.2f} ms",
+                                     ok ? "OK" : "FAIL", pattern, expect.size(), ref_ms, find_ms, legacy_ms)
+                      << std::endl;
+        }
+        // 默认区分大小写, 折叠需显式打开
+        std::string folded = (root / "**" / fs::u8path("отчёт_*.log")).string();
+        AMPath::FindLimits limits;
+        size_t exact = AMPath::find(folded, limits).paths.size();
+        limits.ignore_case = true;
+        size_t ignored = AMPath::find(folded, limits).paths.size();
+        std::cout << fmt::format("{:<4} ignore_case  default {} paths  folded {} paths", exact == 0 && ignored == 1 ? "OK" : "FAIL", exact, ignored) << std::endl;
+        fs::remove_all(root);
+    }
+
+    // 链接指回祖先或指向已有目录时, 每个目录只枚举一次, 命中的文件只出现一次
+    void LinkConformanceBench()
+    {
+        fs::path root = fs::temp_directory_path() / "ampath_bench_links";
+        fs::remove_all(root);
+        fs::create_directories(root / "a" / "b");
+        std::ofstream(root / "a" / "b" / "f.txt");
+        std::error_code ec;
+        fs::create_directory_symlink(root / "a", root / "la", ec);
+        fs::create_directory_symlink("..", root / "a" / "b" / "up", ec);
+        if (ec)
+        {
+            std::cout << "links: symlink unavailable, skipped" << std::endl;
+            fs::remove_all(root);
+            return;
+        }
+        for (size_t threads : {1, 4})
+        {
+            AMPath::GetIOCounters().Reset();
+            auto paths = AMPath::find((root / "**" / "*.txt").string(), AMPathTools::ENUMS::SearchType::All, false, true, nullptr, threads);
+            // 根 2 项, a 1 项, b 2 项; 经 la 或 up 再次到达的目录不再读取
+            uint64_t entries = AMPath::GetIOCounters().Snapshot().entries;
+            bool ok = paths.size() == 1 && entries == 5;
+            std::cout << fmt::format("{:<4} links threads {}  {} paths  {} entries read", ok ? "OK" : "FAIL", threads, paths.size(), entries) << std::endl;
+        }
+        fs::remove_all(root);
+    }
+
+    // 单个大目录: directory_iterator + 逐个判断类型 与 DirEnumerator 直接读取枚举类型
+    void EnumBench(size_t files, size_t rounds)
+    {
+        fs::path root = fs::temp_directory_path() / "AMPathBench_enum";
+        fs::remove_all(root);
+        fs::create_directories(root);
+        for (size_t i = 0; i < files; i++)
+        {
+            if (i % 16 == 0)
+            {
+                fs::create_directory(root / fmt::format("dir_{}", i));
+            }
+            else
+            {
+                std::ofstream(root / fmt::format("file_{:06}.txt", i));
+            }
+        }
+        size_t iter_dirs = 0;
+        double iter_ms = Time([&]()
+                              {
+                                  size_t dirs = 0;
+                                  for (size_t r = 0; r < rounds; r++)
+                                  {
+                                      for (auto &entry : fs::directory_iterator(root))
+                                      {
+                                          dirs += entry.is_directory();
+                                      }
+                                  }
+                                  return dirs; },
+                              iter_dirs);
+        size_t enum_dirs = 0;
+        double enum_ms = Time([&]()
+                              {
+                                  size_t dirs = 0;
+                                  for (size_t r = 0; r < rounds; r++)
+                                  {
+                                      AMPathTools::DirEnumerator dir(root);
+                                      AMPathTools::DirEntry entry;
+                                      while (dir.Next(entry))
+                                      {
+                                          dirs += entry.type == AMPathTools::EntryType::Directory;
+                                      }
+                                  }
+                                  return dirs; },
+                              enum_dirs);
+        size_t size = 0;
+        double size_ms = Time([&]()
+                              { return static_cast<size_t>(AMPath::getsize(root.string())); },
+                              size);
+        std::cout << fmt::format("enum {} entries x{}: directory_iterator: {:.2f} ms ({} dirs)  DirEnumerator: {:.2f} ms  getsize: {:.2f} ms",
+                                 files, rounds, iter_ms, iter_dirs, enum_ms, size_ms)
+                  << std::endl;
+        fs::remove_all(root);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t count = argc > 1 ? std::stoul(argv[1]) : 200000;
+    auto names = AMPathBench::MakeNames(count);
+    std::cout << "names: " << names.size() << std::endl;
+
+    AMPathBench::MatchBench(names, "*.log", false);
+    AMPathBench::MatchBench(names, "report_*", false);
+    AMPathBench::MatchBench(names, "*_2025*.csv", false);
+    AMPathBench::MatchBench(names, "data_2021_1.tmp", false);
+    AMPathBench::MatchBench(names, "<^img_\\d+_\\d+\\.bin$", true);
+    AMPathBench::MatchBench(names, "отчёт_*.LOG", false);
+    AMPathBench::MatchBench(names, "*_202[3-5]_*.{log,csv}", false);
+    AMPathBench::MatchBench(names, "img_20??_*[!0-4].bin", false);
+    AMPathBench::CacheBench(20000);
+    AMPathBench::EnumBench(50000, 10);
+    AMPathBench::TreeBench(6, "a/**/b/**/*.txt");
+    AMPathBench::TreeBench(6, "**/c/*.txt");
+    AMPathBench::StreamBench(7, "**/*.txt");
+    AMPathBench::SizeBench(7);
+    AMPathBench::SnapshotBench(6);
+    AMPathBench::ExcludeBench(6);
+    AMPathBench::StatBench(20000);
+    AMPathBench::MetaBench(20000);
+    AMPathBench::BatchBench(100000);
+    AMPathBench::TableBench(7);
+    AMPathBench::ConformanceBench(5);
+    AMPathBench::IgnoreConformanceBench();
+    AMPathBench::LinkConformanceBench();
+    return 0;
+}
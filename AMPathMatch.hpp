@@ -0,0 +1,1088 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fmt/format.h>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace AMPathTools
+{
+    // 所有平台默认区分大小写, 需要折叠时由调用方显式传入 ignore_case (如 FindLimits::ignore_case)
+    constexpr bool DefaultIgnoreCase = false;
+
+    // 非法字节原样返回并打上高位标记, 保证折叠与重新编码时不被改写
+    constexpr uint32_t InvalidCodepoint = 0x80000000;
+
+    uint32_t next_codepoint(std::string_view str, size_t &pos)
+    {
+        unsigned char c = str[pos];
+        if (c < 0x80)
+        {
+            pos++;
+            return c;
+        }
+        int extra = 0;
+        uint32_t cp = 0;
+        if ((c & 0xE0) == 0xC0)
+        {
+            extra = 1;
+            cp = c & 0x1F;
+        }
+        else if ((c & 0xF0) == 0xE0)
+        {
+            extra = 2;
+            cp = c & 0x0F;
+        }
+        else if ((c & 0xF8) == 0xF0)
+        {
+            extra = 3;
+            cp = c & 0x07;
+        }
+        else
+        {
+            pos++;
+            return InvalidCodepoint | c;
+        }
+        if (pos + extra >= str.size())
+        {
+            pos++;
+            return InvalidCodepoint | c;
+        }
+        for (int i = 1; i <= extra; i++)
+        {
+            unsigned char cc = str[pos + i];
+            if ((cc & 0xC0) != 0x80)
+            {
+                pos++;
+                return InvalidCodepoint | c;
+            }
+            cp = (cp << 6) | (cc & 0x3F);
+        }
+        pos += extra + 1;
+        return cp;
+    }
+
+    void append_utf8(std::string &out, uint32_t cp)
+    {
+        if (cp & InvalidCodepoint)
+        {
+            out += static_cast<char>(cp & 0xFF);
+        }
+        else if (cp < 0x80)
+        {
+            out += static_cast<char>(cp);
+        }
+        else if (cp < 0x800)
+        {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000)
+        {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    std::wstring utf8_to_wide(std::string_view str)
+    {
+        std::wstring out;
+        out.reserve(str.size());
+        size_t pos = 0;
+        while (pos < str.size())
+        {
+            uint32_t cp = next_codepoint(str, pos);
+            if (cp & InvalidCodepoint)
+            {
+                cp = 0xFFFD;
+            }
+            if (sizeof(wchar_t) == 2 && cp >= 0x10000)
+            {
+                cp -= 0x10000;
+                out += static_cast<wchar_t>(0xD800 + (cp >> 10));
+                out += static_cast<wchar_t>(0xDC00 + (cp & 0x3FF));
+                continue;
+            }
+            out += static_cast<wchar_t>(cp);
+        }
+        return out;
+    }
+
+    // 简单大小写折叠表: stride 为 2 时只有与 first 奇偶相同的码位需要折叠
+    struct FoldRange
+    {
+        uint32_t first;
+        uint32_t last;
+        int32_t delta;
+        uint32_t stride;
+    };
+
+    constexpr FoldRange FoldTable[] = {
+        {0x00B5, 0x00B5, 775, 1},
+        {0x00C0, 0x00D6, 32, 1},
+        {0x00D8, 0x00DE, 32, 1},
+        {0x0100, 0x012F, 1, 2},
+        {0x0132, 0x0137, 1, 2},
+        {0x0139, 0x0148, 1, 2},
+        {0x014A, 0x0177, 1, 2},
+        {0x0178, 0x0178, -121, 1},
+        {0x0179, 0x017E, 1, 2},
+        {0x0386, 0x0386, 38, 1},
+        {0x0388, 0x038A, 37, 1},
+        {0x038C, 0x038C, 64, 1},
+        {0x038E, 0x038F, 63, 1},
+        {0x0391, 0x03A1, 32, 1},
+        {0x03A3, 0x03AB, 32, 1},
+        {0x03C2, 0x03C2, 1, 1},
+        {0x0400, 0x040F, 80, 1},
+        {0x0410, 0x042F, 32, 1},
+        {0x0460, 0x0481, 1, 2},
+        {0x048A, 0x04BF, 1, 2},
+        {0x04C0, 0x04C0, 15, 1},
+        {0x04C1, 0x04CE, 1, 2},
+        {0x04D0, 0x052F, 1, 2},
+        {0x0531, 0x0556, 48, 1},
+        {0x10A0, 0x10C5, 7264, 1},
+        {0x1E00, 0x1E95, 1, 2},
+        {0x1E9E, 0x1E9E, -7615, 1},
+        {0x1EA0, 0x1EFF, 1, 2},
+        {0x2160, 0x216F, 16, 1},
+        {0x24B6, 0x24CF, 26, 1},
+        {0x2C00, 0x2C2E, 48, 1},
+        {0xFF21, 0xFF3A, 32, 1},
+        {0x10400, 0x10427, 40, 1},
+    };
+
+    uint32_t fold_codepoint(uint32_t cp)
+    {
+        if (cp < 0x80)
+        {
+            return (cp >= 'A' && cp <= 'Z') ? cp + 32 : cp;
+        }
+        auto it = std::upper_bound(std::begin(FoldTable), std::end(FoldTable), cp, [](uint32_t value, const FoldRange &range)
+                                   { return value < range.first; });
+        if (it == std::begin(FoldTable))
+        {
+            return cp;
+        }
+        const FoldRange &range = *(it - 1);
+        if (cp > range.last || (cp - range.first) % range.stride != 0)
+        {
+            return cp;
+        }
+        return static_cast<uint32_t>(static_cast<int64_t>(cp) + range.delta);
+    }
+
+    // ASCII 字节直接转换, 只有多字节序列才解码查表
+    void fold_utf8(std::string_view str, std::string &out)
+    {
+        out.resize(str.size());
+        size_t pos = 0;
+        for (; pos < str.size(); pos++)
+        {
+            unsigned char c = str[pos];
+            if (c >= 0x80)
+            {
+                break;
+            }
+            out[pos] = (c >= 'A' && c <= 'Z') ? static_cast<char>(c + 32) : static_cast<char>(c);
+        }
+        out.resize(pos);
+        while (pos < str.size())
+        {
+            unsigned char c = str[pos];
+            if (c < 0x80)
+            {
+                out += (c >= 'A' && c <= 'Z') ? static_cast<char>(c + 32) : static_cast<char>(c);
+                pos++;
+                continue;
+            }
+            size_t start = pos;
+            uint32_t cp = next_codepoint(str, pos);
+            uint32_t folded = fold_codepoint(cp);
+            if (folded == cp)
+            {
+                out.append(str.data() + start, pos - start);
+            }
+            else
+            {
+                append_utf8(out, folded);
+            }
+        }
+    }
+
+    std::string fold_utf8(std::string_view str)
+    {
+        std::string out;
+        fold_utf8(str, out);
+        return out;
+    }
+
+    class CompiledPattern
+    {
+    public:
+        enum class Kind
+        {
+            Literal = 0,
+            Glob = 1,
+            Regex = 2,
+            Recursive = 3
+        };
+
+        CompiledPattern() {}
+
+        // pattern 与之后匹配的名字均为 UTF-8
+        CompiledPattern(const std::string &pattern, bool use_regex, bool ignore_case = DefaultIgnoreCase) : source(pattern), ignore_case(ignore_case)
+        {
+            if (pattern == "**")
+            {
+                kind = Kind::Recursive;
+                return;
+            }
+            if (use_regex && !pattern.empty() && pattern.front() == '<')
+            {
+                kind = Kind::Regex;
+                try
+                {
+                    auto flags = std::regex_constants::ECMAScript;
+                    if (ignore_case)
+                    {
+                        flags |= std::regex_constants::icase;
+                    }
+                    regex = std::make_shared<const std::wregex>(utf8_to_wide(pattern.substr(1)), flags);
+                }
+                catch (const std::exception &e)
+                {
+                    error = fmt::format("Pattern \"{}\" parsing failed: {}", pattern, e.what());
+                }
+                ExtractRegexAnchors(pattern.substr(1));
+                return;
+            }
+
+            // 先展开 {a,b}, 再把每个分支切成 字面量 / ? / [..] / * 记号
+            std::vector<std::string> branches;
+            if (!ExpandBraces(pattern, branches))
+            {
+                error = fmt::format("Pattern \"{}\" expands to more than {} alternatives", pattern, MaxAlternatives);
+                kind = Kind::Glob;
+                return;
+            }
+            bool simple = branches.size() == 1;
+            for (auto &branch : branches)
+            {
+                alternatives.push_back(Tokenize(branch));
+                for (auto &token : alternatives.back())
+                {
+                    if (token.type == TokenType::Any || token.type == TokenType::Class)
+                    {
+                        simple = false;
+                    }
+                }
+            }
+            if (simple)
+            {
+                const std::vector<Token> &tokens = alternatives.front();
+                if (tokens.size() <= 1 && (tokens.empty() || tokens.front().type == TokenType::Literal))
+                {
+                    kind = Kind::Literal;
+                    prefix = tokens.empty() ? "" : tokens.front().text;
+                    min_size = prefix.size();
+                    alternatives.clear();
+                    return;
+                }
+                // 只含 * 时按 * 切分为字面量片段, 首尾片段分别锚定在名字的头尾
+                kind = Kind::Glob;
+                std::string cur = "";
+                for (auto &token : tokens)
+                {
+                    if (token.type == TokenType::Star)
+                    {
+                        pieces.push_back(cur);
+                        cur.clear();
+                    }
+                    else
+                    {
+                        cur += token.text;
+                    }
+                }
+                pieces.push_back(cur);
+                alternatives.clear();
+
+                prefix = pieces.front();
+                suffix = pieces.back();
+                min_size = prefix.size() + suffix.size();
+                for (size_t i = 1; i + 1 < pieces.size(); i++)
+                {
+                    min_size += pieces[i].size();
+                    if (pieces[i].size() > infix.size())
+                    {
+                        infix = pieces[i];
+                    }
+                }
+                return;
+            }
+            kind = Kind::Glob;
+            ExtractTokenAnchors();
+        }
+
+        // 只用字面量锚点做快速排除, 返回 false 时名字一定不匹配
+        bool Prefilter(std::string_view name) const
+        {
+            if (!ignore_case)
+            {
+                return PrefilterSubject(name);
+            }
+            thread_local std::string folded;
+            fold_utf8(name, folded);
+            return PrefilterSubject(folded);
+        }
+
+        bool Match(std::string_view name) const
+        {
+            if (kind == Kind::Recursive)
+            {
+                return true;
+            }
+            if (!error.empty())
+            {
+                return false;
+            }
+            std::string_view subject = name;
+            thread_local std::string folded;
+            if (ignore_case)
+            {
+                fold_utf8(name, folded);
+                subject = folded;
+            }
+            if (!PrefilterSubject(subject))
+            {
+                return false;
+            }
+            switch (kind)
+            {
+            case Kind::Literal:
+                return subject.size() == prefix.size();
+            case Kind::Glob:
+                return alternatives.empty() ? MatchGlob(subject) : MatchAlternatives(subject);
+            case Kind::Regex:
+                if (!regex)
+                {
+                    return false;
+                }
+                try
+                {
+                    return std::regex_search(utf8_to_wide(name), *regex);
+                }
+                catch (const std::exception &e)
+                {
+                    return false;
+                }
+            default:
+                return false;
+            }
+        }
+
+        Kind GetKind() const
+        {
+            return kind;
+        }
+
+        bool IsRecursive() const
+        {
+            return kind == Kind::Recursive;
+        }
+
+        bool IsIgnoreCase() const
+        {
+            return ignore_case;
+        }
+
+        bool IsValid() const
+        {
+            return error.empty();
+        }
+
+        const std::string &GetError() const
+        {
+            return error;
+        }
+
+        const std::string &GetSource() const
+        {
+            return source;
+        }
+
+        const std::string &GetPrefix() const
+        {
+            return prefix;
+        }
+
+        const std::string &GetSuffix() const
+        {
+            return suffix;
+        }
+
+        const std::string &GetInfix() const
+        {
+            return infix;
+        }
+
+    private:
+        enum class TokenType
+        {
+            Literal = 0,
+            Any = 1,
+            Class = 2,
+            Star = 3
+        };
+
+        struct Token
+        {
+            TokenType type = TokenType::Literal;
+            std::string text{};
+            std::vector<std::pair<uint32_t, uint32_t>> ranges{};
+            bool negated = false;
+        };
+
+        static constexpr size_t MaxAlternatives = 256;
+
+        Kind kind = Kind::Literal;
+        std::string source;
+        bool ignore_case = false;
+        std::string error;
+        std::vector<std::string> pieces;
+        std::vector<std::vector<Token>> alternatives;
+        std::shared_ptr<const std::wregex> regex;
+        std::string prefix;
+        std::string suffix;
+        std::string infix;
+        size_t min_size = 0;
+
+        bool PrefilterSubject(std::string_view name) const
+        {
+            if (name.size() < min_size)
+            {
+                return false;
+            }
+            if (!prefix.empty() && std::memcmp(name.data(), prefix.data(), prefix.size()) != 0)
+            {
+                return false;
+            }
+            if (!suffix.empty() && std::memcmp(name.data() + name.size() - suffix.size(), suffix.data(), suffix.size()) != 0)
+            {
+                return false;
+            }
+            if (!infix.empty())
+            {
+                std::string_view body = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+                if (body.find(infix) == std::string_view::npos)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // 首尾片段已由 Prefilter 校验, 这里只按顺序查找中间片段
+        bool MatchGlob(std::string_view name) const
+        {
+            size_t pos = prefix.size();
+            size_t end = name.size() - suffix.size();
+            for (size_t i = 1; i + 1 < pieces.size(); i++)
+            {
+                const std::string &piece = pieces[i];
+                if (piece.empty())
+                {
+                    continue;
+                }
+                size_t found = name.find(piece, pos);
+                if (found == std::string_view::npos || found + piece.size() > end)
+                {
+                    return false;
+                }
+                pos = found + piece.size();
+            }
+            return true;
+        }
+
+        // 返回与 pos 处 [ 配对的 ], 开头的 ] 与 !/^ 之后的 ] 属于集合本身
+        static size_t FindClassEnd(const std::string &text, size_t pos)
+        {
+            size_t i = pos + 1;
+            if (i < text.size() && (text[i] == '!' || text[i] == '^'))
+            {
+                i++;
+            }
+            if (i < text.size() && text[i] == ']')
+            {
+                i++;
+            }
+            for (; i < text.size(); i++)
+            {
+                if (text[i] == ']')
+                {
+                    return i;
+                }
+            }
+            return std::string::npos;
+        }
+
+        // 只展开闭合且含顶层逗号的 {}, {abc} 与未闭合的 { 按字面量处理
+        static bool ExpandBraces(const std::string &text, std::vector<std::string> &out)
+        {
+            for (size_t open = 0; open < text.size(); open++)
+            {
+                if (text[open] == '[')
+                {
+                    size_t end = FindClassEnd(text, open);
+                    if (end != std::string::npos)
+                    {
+                        open = end;
+                    }
+                    continue;
+                }
+                if (text[open] != '{')
+                {
+                    continue;
+                }
+                std::vector<size_t> commas;
+                size_t close = std::string::npos;
+                int depth = 0;
+                for (size_t i = open + 1; i < text.size() && close == std::string::npos; i++)
+                {
+                    char c = text[i];
+                    if (c == '[')
+                    {
+                        size_t end = FindClassEnd(text, i);
+                        if (end != std::string::npos)
+                        {
+                            i = end;
+                        }
+                    }
+                    else if (c == '{')
+                    {
+                        depth++;
+                    }
+                    else if (c == '}')
+                    {
+                        if (depth == 0)
+                        {
+                            close = i;
+                        }
+                        else
+                        {
+                            depth--;
+                        }
+                    }
+                    else if (c == ',' && depth == 0)
+                    {
+                        commas.push_back(i);
+                    }
+                }
+                if (close == std::string::npos || commas.empty())
+                {
+                    continue;
+                }
+                std::string head = text.substr(0, open);
+                std::string tail = text.substr(close + 1);
+                size_t start = open + 1;
+                commas.push_back(close);
+                for (auto comma : commas)
+                {
+                    if (!ExpandBraces(head + text.substr(start, comma - start) + tail, out))
+                    {
+                        return false;
+                    }
+                    start = comma + 1;
+                }
+                return true;
+            }
+            if (out.size() >= MaxAlternatives)
+            {
+                return false;
+            }
+            out.push_back(text);
+            return true;
+        }
+
+        // body 为 [ ] 之间的内容; 忽略大小写时额外记录折叠后的区间
+        Token ParseClass(std::string_view body) const
+        {
+            Token token;
+            token.type = TokenType::Class;
+            size_t pos = 0;
+            if (!body.empty() && (body[0] == '!' || body[0] == '^'))
+            {
+                token.negated = true;
+                pos++;
+            }
+            while (pos < body.size())
+            {
+                uint32_t lo = next_codepoint(body, pos);
+                uint32_t hi = lo;
+                if (pos + 1 < body.size() && body[pos] == '-')
+                {
+                    pos++;
+                    hi = next_codepoint(body, pos);
+                }
+                if (lo > hi)
+                {
+                    continue;
+                }
+                token.ranges.emplace_back(lo, hi);
+                if (!ignore_case)
+                {
+                    continue;
+                }
+                uint32_t flo = fold_codepoint(lo);
+                uint32_t fhi = fold_codepoint(hi);
+                if (flo != lo && static_cast<int64_t>(flo) - lo == static_cast<int64_t>(fhi) - hi)
+                {
+                    token.ranges.emplace_back(flo, fhi);
+                }
+            }
+            return token;
+        }
+
+        std::vector<Token> Tokenize(const std::string &text) const
+        {
+            std::vector<Token> tokens;
+            size_t pos = 0;
+            while (pos < text.size())
+            {
+                char c = text[pos];
+                if (c == '*')
+                {
+                    // 连续的 * 合并为一个
+                    if (tokens.empty() || tokens.back().type != TokenType::Star)
+                    {
+                        tokens.push_back({TokenType::Star});
+                    }
+                    pos++;
+                    continue;
+                }
+                if (c == '?')
+                {
+                    tokens.push_back({TokenType::Any});
+                    pos++;
+                    continue;
+                }
+                if (c == '[')
+                {
+                    size_t end = FindClassEnd(text, pos);
+                    if (end != std::string::npos)
+                    {
+                        tokens.push_back(ParseClass(std::string_view(text).substr(pos + 1, end - pos - 1)));
+                        pos = end + 1;
+                        continue;
+                    }
+                }
+                if (tokens.empty() || tokens.back().type != TokenType::Literal)
+                {
+                    tokens.push_back({TokenType::Literal});
+                }
+                size_t start = pos;
+                next_codepoint(text, pos);
+                tokens.back().text.append(text, start, pos - start);
+            }
+            if (ignore_case)
+            {
+                for (auto &token : tokens)
+                {
+                    if (token.type == TokenType::Literal)
+                    {
+                        token.text = fold_utf8(token.text);
+                    }
+                }
+            }
+            return tokens;
+        }
+
+        // 多分支时取各分支首尾字面量的公共前后缀, 只有单分支才提取中间片段
+        void ExtractTokenAnchors()
+        {
+            min_size = std::string::npos;
+            for (size_t i = 0; i < alternatives.size(); i++)
+            {
+                const std::vector<Token> &tokens = alternatives[i];
+                size_t size = 0;
+                for (auto &token : tokens)
+                {
+                    size += token.type == TokenType::Literal ? token.text.size() : (token.type == TokenType::Star ? 0 : 1);
+                }
+                min_size = std::min<size_t>(min_size, size);
+                bool literal_head = !tokens.empty() && tokens.front().type == TokenType::Literal;
+                bool literal_tail = !tokens.empty() && tokens.back().type == TokenType::Literal;
+                std::string_view head = literal_head ? std::string_view(tokens.front().text) : std::string_view();
+                std::string_view tail = literal_tail ? std::string_view(tokens.back().text) : std::string_view();
+                if (i == 0)
+                {
+                    prefix = std::string(head);
+                    suffix = std::string(tail);
+                    continue;
+                }
+                size_t n = 0;
+                while (n < prefix.size() && n < head.size() && prefix[n] == head[n])
+                {
+                    n++;
+                }
+                prefix.resize(n);
+                n = 0;
+                while (n < suffix.size() && n < tail.size() && suffix[suffix.size() - 1 - n] == tail[tail.size() - 1 - n])
+                {
+                    n++;
+                }
+                suffix.erase(0, suffix.size() - n);
+            }
+            if (alternatives.size() != 1)
+            {
+                return;
+            }
+            const std::vector<Token> &tokens = alternatives.front();
+            for (size_t i = 1; i + 1 < tokens.size(); i++)
+            {
+                if (tokens[i].type == TokenType::Literal && tokens[i].text.size() > infix.size())
+                {
+                    infix = tokens[i].text;
+                }
+            }
+        }
+
+        static bool MatchClass(const Token &token, uint32_t cp)
+        {
+            bool found = false;
+            for (auto &range : token.ranges)
+            {
+                if (cp >= range.first && cp <= range.second)
+                {
+                    found = true;
+                    break;
+                }
+            }
+            return found != token.negated;
+        }
+
+        // 单星号回溯: 失配时回到最近一个 * 多吞一段, 最坏 O(n*m)
+        static bool MatchTokens(const std::vector<Token> &tokens, std::string_view name)
+        {
+            size_t t = 0;
+            size_t pos = 0;
+            size_t star_t = std::string::npos;
+            size_t star_pos = 0;
+            while (true)
+            {
+                if (t < tokens.size())
+                {
+                    const Token &token = tokens[t];
+                    if (token.type == TokenType::Star)
+                    {
+                        star_t = t++;
+                        // * 后是字面量时直接跳到它下一次出现的位置, 找不到则更晚的起点也不可能匹配
+                        if (t < tokens.size() && tokens[t].type == TokenType::Literal)
+                        {
+                            pos = name.find(tokens[t].text, pos);
+                            if (pos == std::string_view::npos)
+                            {
+                                return false;
+                            }
+                        }
+                        star_pos = pos;
+                        continue;
+                    }
+                    if (pos < name.size())
+                    {
+                        size_t next = pos;
+                        bool ok = true;
+                        if (token.type == TokenType::Literal)
+                        {
+                            ok = name.compare(pos, token.text.size(), token.text) == 0;
+                            next = pos + token.text.size();
+                        }
+                        else if (token.type == TokenType::Any)
+                        {
+                            next_codepoint(name, next);
+                        }
+                        else
+                        {
+                            ok = MatchClass(token, next_codepoint(name, next));
+                        }
+                        if (ok)
+                        {
+                            pos = next;
+                            t++;
+                            continue;
+                        }
+                    }
+                }
+                else if (pos == name.size())
+                {
+                    return true;
+                }
+                if (star_t == std::string::npos || star_pos >= name.size())
+                {
+                    return false;
+                }
+                t = star_t + 1;
+                if (t < tokens.size() && tokens[t].type == TokenType::Literal)
+                {
+                    star_pos = name.find(tokens[t].text, star_pos + 1);
+                    if (star_pos == std::string_view::npos)
+                    {
+                        return false;
+                    }
+                }
+                else
+                {
+                    next_codepoint(name, star_pos);
+                }
+                pos = star_pos;
+            }
+        }
+
+        bool MatchAlternatives(std::string_view name) const
+        {
+            for (auto &tokens : alternatives)
+            {
+                if (MatchTokens(tokens, name))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        static bool IsRegexMeta(char c)
+        {
+            return std::strchr(".[]()*+?{}|^$\\", c) != nullptr;
+        }
+
+        // 只提取 ^abc 与 abc$ 形式的确定字面量, 含 | 的表达式不做提取
+        void ExtractRegexAnchors(const std::string &re)
+        {
+            if (re.find('|') != std::string::npos)
+            {
+                return;
+            }
+            size_t n = re.size();
+            if (n > 1 && re[0] == '^')
+            {
+                std::string lit;
+                size_t i = 1;
+                while (i < n)
+                {
+                    char c = re[i];
+                    if (c == '\\' && i + 1 < n && std::ispunct(static_cast<unsigned char>(re[i + 1])))
+                    {
+                        lit += re[i + 1];
+                        i += 2;
+                    }
+                    else if (IsRegexMeta(c))
+                    {
+                        break;
+                    }
+                    else
+                    {
+                        lit += c;
+                        i++;
+                    }
+                }
+                if (i < n && !lit.empty() && std::strchr("*?{+", re[i]) != nullptr)
+                {
+                    lit.pop_back();
+                }
+                prefix = lit;
+            }
+            if (n > 1 && re[n - 1] == '$' && (n < 2 || re[n - 2] != '\\'))
+            {
+                std::string lit;
+                size_t j = n - 1;
+                while (j > 0)
+                {
+                    char c = re[j - 1];
+                    size_t slashes = 0;
+                    while (j - 1 >= slashes + 1 && re[j - 2 - slashes] == '\\')
+                    {
+                        slashes++;
+                    }
+                    if (slashes % 2 == 1)
+                    {
+                        if (!std::ispunct(static_cast<unsigned char>(c)))
+                        {
+                            break;
+                        }
+                        lit.insert(lit.begin(), c);
+                        j -= 2;
+                    }
+                    else if (IsRegexMeta(c))
+                    {
+                        break;
+                    }
+                    else
+                    {
+                        lit.insert(lit.begin(), c);
+                        j--;
+                    }
+                }
+                suffix = lit;
+            }
+            if (ignore_case)
+            {
+                // std::regex 的 icase 依赖 locale, 只保留 ASCII 锚点以免误排除
+                auto is_ascii = [](const std::string &lit)
+                {
+                    return std::all_of(lit.begin(), lit.end(), [](char c)
+                                       { return static_cast<unsigned char>(c) < 0x80; });
+                };
+                prefix = is_ascii(prefix) ? fold_utf8(prefix) : "";
+                suffix = is_ascii(suffix) ? fold_utf8(suffix) : "";
+            }
+            // 正则的首尾字面量可能重叠, 长度下限只能取较长者
+            min_size = std::max<size_t>(prefix.size(), suffix.size());
+        }
+    };
+
+    using PatternPtr = std::shared_ptr<const CompiledPattern>;
+
+    class PatternCache
+    {
+    public:
+        PatternCache(size_t capacity = 256) : capacity(capacity) {}
+
+        PatternPtr Get(const std::string &pattern, bool use_regex, bool ignore_case = DefaultIgnoreCase)
+        {
+            Key key{pattern, use_regex, ignore_case};
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                auto it = index.find(key);
+                if (it != index.end())
+                {
+                    items.splice(items.begin(), items, it->second);
+                    hits++;
+                    return it->second->second;
+                }
+                misses++;
+            }
+
+            // 编译可能较慢, 放在锁外进行
+            PatternPtr compiled = std::make_shared<const CompiledPattern>(pattern, use_regex, ignore_case);
+
+            std::lock_guard<std::mutex> lock(mtx);
+            auto it = index.find(key);
+            if (it != index.end())
+            {
+                items.splice(items.begin(), items, it->second);
+                return it->second->second;
+            }
+            if (capacity == 0)
+            {
+                return compiled;
+            }
+            items.emplace_front(key, compiled);
+            index[key] = items.begin();
+            Shrink();
+            return compiled;
+        }
+
+        void SetCapacity(size_t new_capacity)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            capacity = new_capacity;
+            Shrink();
+        }
+
+        size_t GetCapacity() const
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            return capacity;
+        }
+
+        size_t Size() const
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            return items.size();
+        }
+
+        uint64_t GetHits() const
+        {
+            return hits.load();
+        }
+
+        uint64_t GetMisses() const
+        {
+            return misses.load();
+        }
+
+        void Clear()
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            items.clear();
+            index.clear();
+            hits = 0;
+            misses = 0;
+        }
+
+    private:
+        struct Key
+        {
+            std::string pattern;
+            bool use_regex;
+            bool ignore_case;
+
+            bool operator==(const Key &other) const
+            {
+                return pattern == other.pattern && use_regex == other.use_regex && ignore_case == other.ignore_case;
+            }
+        };
+
+        struct KeyHash
+        {
+            size_t operator()(const Key &key) const
+            {
+                return std::hash<std::string>()(key.pattern) ^ (key.use_regex ? 0x9e3779b97f4a7c15ULL : 0) ^ (key.ignore_case ? 0xc2b2ae3d27d4eb4fULL : 0);
+            }
+        };
+
+        size_t capacity;
+        mutable std::mutex mtx;
+        std::list<std::pair<Key, PatternPtr>> items;
+        std::unordered_map<Key, std::list<std::pair<Key, PatternPtr>>::iterator, KeyHash> index;
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+
+        void Shrink()
+        {
+            while (items.size() > capacity)
+            {
+                index.erase(items.back().first);
+                items.pop_back();
+            }
+        }
+    };
+
+    PatternCache &GetPatternCache()
+    {
+        static PatternCache cache;
+        return cache;
+    }
+
+    PatternPtr GetCompiledPattern(const std::string &pattern, bool use_regex, bool ignore_case = DefaultIgnoreCase)
+    {
+        return GetPatternCache().Get(pattern, use_regex, ignore_case);
+    }
+}
@@ -3,56 +3,18 @@
 #include <filesystem>
 #include <fmt/format.h>
 #include <functional>
-#include <regex>
+#include <optional>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
-constexpr char *exc1 = "am1sp2exg6";
-constexpr char *exc2 = "amtmpexc5";
-constexpr char *exc3 = "atmasdapxch";
-constexpr char *exc4 = "amtmasdapaexch";
-constexpr char *exc5 = "amtessixhxch";
-constexpr char *exc6 = "amtasdmpexsch";
-
+// 旧接口, 预处理 / 匹配 / 遍历均转发到 AMPath 的同一套实现
 namespace AMPathSearch
 {
     constexpr char *AMERROR = "ERROR";
     constexpr char *AMWARNING = "WARNING";
     namespace fs = std::filesystem;
-    std::string regex_escape(const std::string &input)
-    {
-        std::string escaped;
-        escaped.reserve(input.size() * 2); // 预分配内存优化性能
-
-        for (char c : input)
-        {
-            // 匹配需要转义的正则元字符
-            switch (c)
-            {
-            case '\\':
-            case '^':
-            case '$':
-            case '.':
-            case '|':
-            case '?':
-            case '*':
-            case '+':
-            case '(':
-            case ')':
-            case '[':
-            case ']':
-            case '{':
-            case '}':
-                escaped += '\\'; // 添加转义符
-                break;
-            default:
-                break;
-            }
-            escaped += c; // 追加当前字符
-        }
-
-        return escaped;
-    }
+    using AMPathTools::regex_escape;
 
     using CB = std::function<void(std::string, std::exception)>;
 
@@ -72,222 +34,57 @@ namespace AMPathSearch
 
     std::tuple<std::vector<std::string>, std::string, bool> preprocess(std::string path, bool use_regex)
     {
-        auto path_parts = AMPath::split(path);
-        bool is2star = false;
-        bool is_recursive = false;
-        for (auto it = path_parts.begin(); it != path_parts.end(); ++it)
-        {
-            if (*it == "**")
-            {
-                is_recursive = true;
-                if (is2star)
-                {
-                    path_parts.erase(it);
-                }
-                else
-                {
-                    is2star = true;
-                }
-            }
-            else
-            {
-                is2star = false;
-            }
-        }
-
-        std::vector<std::string> certain_parts;
-        bool is_match;
-        for (auto it = path_parts.begin(); it != path_parts.end(); ++it)
-        {
-            auto &part = *it;
-            if (use_regex)
-            {
-                is_match = std::regex_match(part, std::regex("[\\*\\?<>\\+]"));
-            }
-            else
-            {
-                is_match = part.find('*') == std::string::npos;
-            }
-            if (!is_match)
-            {
-                certain_parts.push_back(part);
-                path_parts.erase(it);
-            }
-            else
-            {
-                break;
-            }
-        }
-        return std::make_tuple(path_parts, AMPath::join(certain_parts), is_recursive);
+        return AMPath::preprocess_parts(path, use_regex);
     }
 
     bool _match(std::string name, std::string pattern, bool use_regex)
     {
-        if (!use_regex)
-        {
-            pattern = pattern.replace(pattern.find('*'), 1, std::string(exc1));
-            pattern = regex_escape(pattern);
-            pattern = pattern.replace(pattern.find(exc1), std::string(exc1).size(), ".*");
-            pattern = '^' + pattern + '$';
-            return std::regex_match(name, std::regex(pattern));
-        }
-        else
+        return AMPathTools::_match(name, pattern, use_regex);
+    }
+
+    // 把 (错误名, 信息) 形式的回调转换为本接口的 (级别, 异常) 形式
+    AMPath::CB wrap_callback(bool silence, CB callback)
+    {
+        if (silence || !callback)
         {
-            pattern = pattern.replace(pattern.find('*'), 1, std::string(exc1));
-            pattern = pattern.replace(pattern.find('?'), 1, std::string(exc2));
-            pattern = pattern.replace(pattern.find('<'), 1, std::string(exc3));
-            pattern = pattern.replace(pattern.find('>'), 1, std::string(exc4));
-            pattern = pattern.replace(pattern.find('+'), 1, std::string(exc5));
-            pattern = regex_escape(pattern);
-            pattern = pattern.replace(pattern.find(exc1), std::string(exc1).size(), ".*");
-            pattern = pattern.replace(pattern.find(exc2), std::string(exc2).size(), "?");
-            pattern = pattern.replace(pattern.find(exc3), std::string(exc3).size(), "[");
-            pattern = pattern.replace(pattern.find(exc4), std::string(exc4).size(), "]");
-            pattern = pattern.replace(pattern.find(exc5), std::string(exc5).size(), "+");
-            pattern = '^' + pattern + '$';
-            return std::regex_match(name, std::regex(pattern));
+            return nullptr;
         }
+        return std::make_shared<std::function<void(std::string, std::string, std::string)>>(
+            [callback](std::string path, std::string error, std::string msg)
+            { callback(AMERROR, std::runtime_error(fmt::format("{} {}: {}", error, path, msg))); });
     }
 
     void search(std::vector<std::string> &results, fs::path root, std::string name, std::vector<std::string> remains, SearchType type, bool use_regex, bool silence, CB callback)
     {
-        if (!remains.empty())
+        std::vector<AMPathTools::PatternPtr> parts = {AMPathTools::GetCompiledPattern(AMPathTools::AMutf8(name), use_regex)};
+        for (auto &part : remains)
         {
-            if (!fs::is_directory(root))
-            {
-                return;
-            }
-            try
-            {
-                for (auto &entry : fs::directory_iterator(root))
-                {
-                    if (name == "**")
-                    {
-                        if (_match(entry.path().filename().string(), remains.front(), use_regex))
-                        {
-                            if (fs::is_directory(entry.path()))
-                            {
-                                auto new_name = remains.front();
-                                auto new_remains = remains;
-                                new_remains.erase(new_remains.begin());
-                                search(results, entry.path(), new_name, new_remains, type, use_regex, silence, callback);
-                            }
-                            else if (type != SearchType::Directory)
-                            {
-                                results.push_back(entry.path().string());
-                            }
-                        }
-                        else if (fs::is_directory(entry.path()))
-                        {
-                            search(results, entry.path(), name, remains, type, use_regex, silence, callback);
-                        }
-                        continue;
-                    }
-                    else if (_match(entry.path().filename().string(), name, use_regex) && fs::is_directory(entry.path()))
-                    {
-                        std::string new_name = remains.front();
-                        auto new_remains = remains;
-                        new_remains.erase(new_remains.begin());
-                        search(results, entry.path(), new_name, new_remains, type, use_regex, silence, callback);
-                    }
-                }
-            }
-            catch (const std::exception e)
-            {
-                if (!silence && callback)
-                {
-                    callback(AMERROR, e);
-                }
-            }
+            parts.push_back(AMPathTools::GetCompiledPattern(AMPathTools::AMutf8(part), use_regex));
         }
-        else
-        {
-            if (!fs::is_directory(root))
-            {
-                if (type == SearchType::Directory && _match(root.filename().string(), name, use_regex))
-                {
-                    results.push_back(root.string());
-                }
-                return;
-            }
-
-            if (name == "**")
-            {
-                for (auto &entry : fs::directory_iterator(root))
-                {
-                    bool is_dir = fs::is_directory(entry.path());
-                    if (!is_dir)
-                    {
-                        if (type != SearchType::Directory)
-                        {
-                            results.push_back(entry.path().string());
-                        }
-                        continue;
-                    }
-                    if (fs::is_empty(entry.path()))
-                    {
-                        if (type != SearchType::File)
-                        {
-                            results.push_back(entry.path().string());
-                        }
-                        continue;
-                    }
-                    search(results, entry.path(), "**", {}, type, use_regex, silence, callback);
-                }
-                return;
-            }
+        AMPath::search(results, root, parts, 0, static_cast<AMPathTools::ENUMS::SearchType>(type), silence, wrap_callback(silence, callback));
+    }
 
-            bool is_dir2;
-            for (auto &entry : fs::directory_iterator(root))
+    std::variant<std::vector<std::string>, std::pair<std::string, std::string>> find(std::string path, SearchType type = SearchType::All, bool use_regex = false, bool silence = false, CB callback = nullptr)
+    {
+        std::optional<std::pair<std::string, std::string>> failure;
+        AMPath::CB wrapped = wrap_callback(silence, callback);
+        auto on_error = std::make_shared<std::function<void(std::string, std::string, std::string)>>(
+            [&](std::string cur_path, std::string error, std::string msg)
             {
-                if (!_match(entry.path().filename().string(), name, use_regex))
-                {
-                    continue;
-                }
-                is_dir2 = fs::is_directory(entry.path());
-                if (is_dir2 && type != SearchType::File)
+                if (error == "FailToParsingRoot")
                 {
-                    results.push_back(entry.path().string());
+                    failure = std::make_pair(std::string(AMERROR), fmt::format("Can't parse the root of the path: {}", cur_path));
                 }
-                else if (!is_dir2 && type != SearchType::Directory)
+                else if (wrapped)
                 {
-                    results.push_back(entry.path().string());
+                    (*wrapped)(cur_path, error, msg);
                 }
-            }
-        }
-    }
-
-    std::variant<std::vector<std::string>, std::pair<std::string, std::string>> find(std::string path, SearchType type = SearchType::All, bool use_regex = false, bool silence = false, CB callback = nullptr)
-    {
-        path = AMPath::realpath(Strip(path), false, '\\');
-        if (fs::exists(path) && !use_regex)
-        {
-            return std::vector<std::string>{path};
-        }
-        auto pre_result = preprocess(path, use_regex);
-        auto root_path = std::get<1>(pre_result);
-        auto match_parts = std::get<0>(pre_result);
-        bool is_recursive = std::get<2>(pre_result);
-        std::vector<std::string> results;
-
-        if (root_path.empty())
+            });
+        auto results = AMPath::find(path, static_cast<AMPathTools::ENUMS::SearchType>(type), use_regex, silence, on_error);
+        if (failure)
         {
-            return std::make_pair(AMERROR, fmt::format("Can't parse the root of the path: {}", path));
+            return *failure;
         }
-
-        if (!fs::exists(root_path))
-        {
-            return {};
-        }
-
-        if (match_parts.empty())
-        {
-            return std::vector<std::string>{root_path};
-        }
-        std::string name_first = match_parts.front();
-        match_parts.erase(match_parts.begin());
-
-        search(results, fs::path(root_path), name_first, match_parts, type, use_regex, silence, callback);
         return results;
     }
 
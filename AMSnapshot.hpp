@@ -0,0 +1,445 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace AMPathTools
+{
+    namespace fs = std::filesystem;
+
+    // 目录的修改时间 (纳秒), 新增 / 删除 / 重命名子项时会改变
+    bool get_dir_mtime(const fs::path &path, uint64_t &mtime)
+    {
+#ifdef _WIN32
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data) || !(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+        {
+            return false;
+        }
+        uint64_t ticks = (static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+        // FILETIME 以 1601 年为起点, 单位 100ns
+        mtime = (ticks - 116444736000000000ull) * 100;
+        return true;
+#else
+        struct stat st;
+        if (::stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+        {
+            return false;
+        }
+#ifdef __APPLE__
+        mtime = static_cast<uint64_t>(st.st_mtimespec.tv_sec) * 1000000000ull + st.st_mtimespec.tv_nsec;
+#else
+        mtime = static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000ull + st.st_mtim.tv_nsec;
+#endif
+        return true;
+#endif
+    }
+
+    // 判断修改时间是否可信的等待时间: 修改时间带有亚秒部分时文件系统精度较高 (粗粒度时钟约 10ms),
+    // 整秒的修改时间可能来自 FAT 等 2 秒精度的文件系统
+    uint64_t mtime_granularity(uint64_t mtime)
+    {
+        return mtime % 1000000000ull != 0 ? 100000000ull : 2000000000ull;
+    }
+
+    // 只读映射整个文件
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        ~MappedFile()
+        {
+            Close();
+        }
+
+        bool Open(const std::string &path)
+        {
+            Close();
+#ifdef _WIN32
+            file = CreateFileW(fs::u8path(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+            {
+                return false;
+            }
+            LARGE_INTEGER file_size;
+            if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+            {
+                Close();
+                return false;
+            }
+            mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!mapping)
+            {
+                Close();
+                return false;
+            }
+            data = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            size = static_cast<size_t>(file_size.QuadPart);
+#else
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+            {
+                return false;
+            }
+            struct stat st;
+            if (::fstat(fd, &st) != 0 || st.st_size == 0)
+            {
+                ::close(fd);
+                return false;
+            }
+            void *addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (addr == MAP_FAILED)
+            {
+                return false;
+            }
+            data = static_cast<const char *>(addr);
+            size = static_cast<size_t>(st.st_size);
+#endif
+            if (!data)
+            {
+                Close();
+                return false;
+            }
+            return true;
+        }
+
+        void Close()
+        {
+#ifdef _WIN32
+            if (data)
+            {
+                UnmapViewOfFile(data);
+            }
+            if (mapping)
+            {
+                CloseHandle(mapping);
+            }
+            if (file != INVALID_HANDLE_VALUE)
+            {
+                CloseHandle(file);
+            }
+            mapping = nullptr;
+            file = INVALID_HANDLE_VALUE;
+#else
+            if (data)
+            {
+                ::munmap(const_cast<char *>(data), size);
+            }
+#endif
+            data = nullptr;
+            size = 0;
+        }
+
+        const char *Data() const
+        {
+            return data;
+        }
+
+        size_t Size() const
+        {
+            return size;
+        }
+
+    private:
+        const char *data = nullptr;
+        size_t size = 0;
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+#endif
+    };
+
+    // 构建快照时使用的内存结构
+    struct SnapshotEntry
+    {
+        std::string name;
+        std::string owner;
+        std::string mode_str;
+        int32_t type = 0;
+        uint32_t mode = 0;
+        uint64_t size = 0;
+        uint64_t atime = 0;
+        uint64_t mtime = 0;
+    };
+
+    struct SnapshotDir
+    {
+        std::string path;
+        uint64_t mtime = 0;
+        // 按名字排序
+        std::vector<SnapshotEntry> entries;
+    };
+
+    // 磁盘格式: 头 | 目录表 (按路径排序) | 条目表 (每个目录连续, 按名字排序) | 字符串池; 全部小端定长, 可直接映射
+    struct SnapshotHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t flags;
+        uint64_t created;
+        uint64_t dir_count;
+        uint64_t entry_count;
+        uint64_t string_bytes;
+    };
+
+    struct SnapshotString
+    {
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    struct SnapshotDirRecord
+    {
+        SnapshotString path;
+        uint64_t mtime;
+        uint64_t first;
+        uint64_t count;
+    };
+
+    struct SnapshotEntryRecord
+    {
+        SnapshotString name;
+        SnapshotString owner;
+        SnapshotString mode_str;
+        int32_t type;
+        uint32_t mode;
+        uint64_t size;
+        uint64_t atime;
+        uint64_t mtime;
+    };
+
+    constexpr char SnapshotMagic[8] = {'A', 'M', 'S', 'N', 'A', 'P', '0', '1'};
+    constexpr uint32_t SnapshotVersion = 1;
+
+    // 映射后的只读快照, 多线程可同时查询
+    class WalkSnapshot
+    {
+    public:
+        // flags 与保存时不一致 (遍历选项不同) 时视为无效
+        bool Load(const std::string &path, uint32_t flags)
+        {
+            header = nullptr;
+            if (!file.Open(path) || file.Size() < sizeof(SnapshotHeader))
+            {
+                return false;
+            }
+            auto head = reinterpret_cast<const SnapshotHeader *>(file.Data());
+            if (std::memcmp(head->magic, SnapshotMagic, sizeof(SnapshotMagic)) != 0 || head->version != SnapshotVersion || head->flags != flags)
+            {
+                file.Close();
+                return false;
+            }
+            // 计数可能被改写, 求和时检查溢出
+            uint64_t dir_bytes = 0;
+            uint64_t entry_bytes = 0;
+            uint64_t expect = sizeof(SnapshotHeader);
+            if (!checked_mul(head->dir_count, sizeof(SnapshotDirRecord), dir_bytes) || !checked_mul(head->entry_count, sizeof(SnapshotEntryRecord), entry_bytes) ||
+                !checked_add(expect, dir_bytes, expect) || !checked_add(expect, entry_bytes, expect) || !checked_add(expect, head->string_bytes, expect) ||
+                expect != file.Size())
+            {
+                file.Close();
+                return false;
+            }
+            header = head;
+            dirs = reinterpret_cast<const SnapshotDirRecord *>(file.Data() + sizeof(SnapshotHeader));
+            entries = reinterpret_cast<const SnapshotEntryRecord *>(dirs + head->dir_count);
+            strings = reinterpret_cast<const char *>(entries + head->entry_count);
+            // 快照可能被截断或改写, 所有下标与字符串引用在这里检查一次, 之后的查询不再检查
+            if (!Validate())
+            {
+                Close();
+                return false;
+            }
+            return true;
+        }
+
+        bool IsLoaded() const
+        {
+            return header != nullptr;
+        }
+
+        void Close()
+        {
+            header = nullptr;
+            file.Close();
+        }
+
+        uint64_t Created() const
+        {
+            return header ? header->created : 0;
+        }
+
+        const SnapshotDirRecord *Find(std::string_view path) const
+        {
+            if (!header)
+            {
+                return nullptr;
+            }
+            const SnapshotDirRecord *end = dirs + header->dir_count;
+            auto it = std::lower_bound(dirs, end, path, [this](const SnapshotDirRecord &record, std::string_view key)
+                                       { return Str(record.path) < key; });
+            return it != end && Str(it->path) == path ? it : nullptr;
+        }
+
+        const SnapshotEntryRecord *Entries(const SnapshotDirRecord &dir) const
+        {
+            return entries + dir.first;
+        }
+
+        std::string_view Str(const SnapshotString &str) const
+        {
+            return std::string_view(strings + str.offset, static_cast<size_t>(str.length));
+        }
+
+    private:
+        MappedFile file;
+        const SnapshotHeader *header = nullptr;
+        const SnapshotDirRecord *dirs = nullptr;
+        const SnapshotEntryRecord *entries = nullptr;
+        const char *strings = nullptr;
+
+        static bool checked_add(uint64_t a, uint64_t b, uint64_t &result)
+        {
+            if (a > UINT64_MAX - b)
+            {
+                return false;
+            }
+            result = a + b;
+            return true;
+        }
+
+        static bool checked_mul(uint64_t a, uint64_t b, uint64_t &result)
+        {
+            if (b != 0 && a > UINT64_MAX / b)
+            {
+                return false;
+            }
+            result = a * b;
+            return true;
+        }
+
+        bool ValidString(const SnapshotString &str) const
+        {
+            return str.offset <= header->string_bytes && str.length <= header->string_bytes - str.offset;
+        }
+
+        // 所有字符串都在字符串池内, 目录的条目区间在条目表内, 目录按路径严格递增 (Find 依赖), 目录内条目按名字严格递增 (diff 依赖)
+        bool Validate() const
+        {
+            for (uint64_t j = 0; j < header->entry_count; j++)
+            {
+                const SnapshotEntryRecord &entry = entries[j];
+                if (!ValidString(entry.name) || !ValidString(entry.owner) || !ValidString(entry.mode_str))
+                {
+                    return false;
+                }
+            }
+            for (uint64_t i = 0; i < header->dir_count; i++)
+            {
+                const SnapshotDirRecord &dir = dirs[i];
+                if (!ValidString(dir.path) || dir.first > header->entry_count || dir.count > header->entry_count - dir.first)
+                {
+                    return false;
+                }
+                if (i > 0 && !(Str(dirs[i - 1].path) < Str(dir.path)))
+                {
+                    return false;
+                }
+                for (uint64_t j = dir.first + 1; j < dir.first + dir.count; j++)
+                {
+                    if (!(Str(entries[j - 1].name) < Str(entries[j].name)))
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+    };
+
+    // 先写临时文件再替换, 中途失败不会破坏旧快照
+    bool save_snapshot(const std::string &path, std::vector<SnapshotDir> &dirs, uint32_t flags, uint64_t created)
+    {
+        std::sort(dirs.begin(), dirs.end(), [](const SnapshotDir &a, const SnapshotDir &b)
+                  { return a.path < b.path; });
+        std::string pool;
+        // 属主与权限字符串的取值很少, 只存一份
+        std::unordered_map<std::string, SnapshotString> interned;
+        auto add = [&pool](const std::string &str)
+        {
+            SnapshotString ref{pool.size(), str.size()};
+            pool += str;
+            return ref;
+        };
+        auto intern = [&](const std::string &str)
+        {
+            auto it = interned.find(str);
+            if (it != interned.end())
+            {
+                return it->second;
+            }
+            return interned.emplace(str, add(str)).first->second;
+        };
+
+        std::vector<SnapshotDirRecord> dir_records;
+        std::vector<SnapshotEntryRecord> entry_records;
+        dir_records.reserve(dirs.size());
+        for (auto &dir : dirs)
+        {
+            dir_records.push_back({add(dir.path), dir.mtime, entry_records.size(), dir.entries.size()});
+            for (auto &entry : dir.entries)
+            {
+                entry_records.push_back({add(entry.name), intern(entry.owner), intern(entry.mode_str), entry.type, entry.mode, entry.size, entry.atime, entry.mtime});
+            }
+        }
+
+        SnapshotHeader header;
+        std::memcpy(header.magic, SnapshotMagic, sizeof(SnapshotMagic));
+        header.version = SnapshotVersion;
+        header.flags = flags;
+        header.created = created;
+        header.dir_count = dir_records.size();
+        header.entry_count = entry_records.size();
+        header.string_bytes = pool.size();
+
+        fs::path target = fs::u8path(path);
+        fs::path tmp = target;
+        tmp += ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out)
+            {
+                return false;
+            }
+            out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char *>(dir_records.data()), dir_records.size() * sizeof(SnapshotDirRecord));
+            out.write(reinterpret_cast<const char *>(entry_records.data()), entry_records.size() * sizeof(SnapshotEntryRecord));
+            out.write(pool.data(), pool.size());
+            if (!out)
+            {
+                return false;
+            }
+        }
+        std::error_code ec;
+        fs::rename(tmp, target, ec);
+        return !ec;
+    }
+}
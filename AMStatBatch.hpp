@@ -0,0 +1,413 @@
+#pragma once
+#include "AMDirEnum.hpp"
+#include "AMWorkPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+#if !defined(_WIN32) && defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(STATX_BASIC_STATS)
+#define AM_HAS_IO_URING 1
+#endif
+#endif
+
+namespace AMPathTools
+{
+#ifdef AM_HAS_IO_URING
+    // 只用于批量 statx 的最小 io_uring 封装, 直接使用系统调用, 不依赖 liburing; 每个线程一个
+    class StatxRing
+    {
+    public:
+        static constexpr unsigned Entries = 256;
+
+        StatxRing(const StatxRing &) = delete;
+        StatxRing &operator=(const StatxRing &) = delete;
+
+        ~StatxRing()
+        {
+            if (sqes)
+            {
+                ::munmap(sqes, sqes_size);
+            }
+            if (cq_ptr && cq_ptr != sq_ptr)
+            {
+                ::munmap(cq_ptr, cq_size);
+            }
+            if (sq_ptr)
+            {
+                ::munmap(sq_ptr, sq_size);
+            }
+            if (ring_fd >= 0)
+            {
+                ::close(ring_fd);
+            }
+        }
+
+        // 当前线程的 ring; 内核不支持或被禁用 (如 seccomp) 时返回 nullptr, 之后不再尝试
+        static StatxRing *Local()
+        {
+            if (!Enabled().load(std::memory_order_relaxed))
+            {
+                return nullptr;
+            }
+            thread_local StatxRing ring;
+            if (ring.ring_fd < 0)
+            {
+                Enabled() = false;
+                return nullptr;
+            }
+            return &ring;
+        }
+
+        // 可由调用方关闭, 用于比较两种后端
+        static std::atomic<bool> &Enabled()
+        {
+            static std::atomic<bool> enabled = true;
+            return enabled;
+        }
+
+        // 先用 Name 填好 count 个名字, 各提交一次 IORING_OP_STATX, 全部完成后返回; count 不超过 Entries;
+        // 结果用 Result (0 或 -errno) 与 Buffer 读取; 缓冲区属于 ring, 出错时内核仍可安全写入
+        bool Run(int dirfd, size_t count, int flags)
+        {
+            unsigned tail = *sq_tail;
+            for (size_t i = 0; i < count; i++)
+            {
+                unsigned index = tail & *sq_mask;
+                struct io_uring_sqe &sqe = sqes[index];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = IORING_OP_STATX;
+                sqe.fd = dirfd;
+                sqe.addr = reinterpret_cast<uint64_t>(names[i]);
+                sqe.len = STATX_BASIC_STATS;
+                sqe.off = reinterpret_cast<uint64_t>(&buffers[i]);
+                sqe.statx_flags = static_cast<uint32_t>(flags);
+                sqe.user_data = i;
+                sq_array[index] = index;
+                tail++;
+            }
+            __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+
+            size_t submitted = 0;
+            size_t reaped = 0;
+            while (reaped < count)
+            {
+                unsigned to_submit = static_cast<unsigned>(count - submitted);
+                long rc = ::syscall(__NR_io_uring_enter, ring_fd, to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                if (rc < 0)
+                {
+                    if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                    {
+                        continue;
+                    }
+                    // 已提交的请求仍会完成, 这里无法安全地复用缓冲区, 放弃此 ring
+                    Enabled() = false;
+                    return false;
+                }
+                submitted += static_cast<size_t>(rc);
+                unsigned head = *cq_head;
+                unsigned cq_end = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+                while (head != cq_end)
+                {
+                    const struct io_uring_cqe &cqe = cqes[head & *cq_mask];
+                    results[cqe.user_data] = cqe.res;
+                    head++;
+                    reaped++;
+                }
+                __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+            }
+            return true;
+        }
+
+        const char *&Name(size_t index)
+        {
+            return names[index];
+        }
+
+        const struct statx &Buffer(size_t index) const
+        {
+            return buffers[index];
+        }
+
+        int Result(size_t index) const
+        {
+            return results[index];
+        }
+
+    private:
+        const char *names[Entries];
+        struct statx buffers[Entries];
+        int results[Entries];
+        int ring_fd = -1;
+        void *sq_ptr = nullptr;
+        void *cq_ptr = nullptr;
+        size_t sq_size = 0;
+        size_t cq_size = 0;
+        size_t sqes_size = 0;
+        unsigned *sq_tail = nullptr;
+        unsigned *sq_mask = nullptr;
+        unsigned *sq_array = nullptr;
+        unsigned *cq_head = nullptr;
+        unsigned *cq_tail = nullptr;
+        unsigned *cq_mask = nullptr;
+        struct io_uring_sqe *sqes = nullptr;
+        struct io_uring_cqe *cqes = nullptr;
+
+        StatxRing()
+        {
+            struct io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            int fd = static_cast<int>(::syscall(__NR_io_uring_setup, Entries, &params));
+            if (fd < 0)
+            {
+                return;
+            }
+            sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+            bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (single)
+            {
+                sq_size = cq_size = std::max(sq_size, cq_size);
+            }
+            sq_ptr = ::mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            if (sq_ptr == MAP_FAILED)
+            {
+                sq_ptr = nullptr;
+                ::close(fd);
+                return;
+            }
+            cq_ptr = single ? sq_ptr : ::mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (cq_ptr == MAP_FAILED)
+            {
+                cq_ptr = nullptr;
+                ::close(fd);
+                return;
+            }
+            sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+            void *sqes_ptr = ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+            if (sqes_ptr == MAP_FAILED)
+            {
+                ::close(fd);
+                return;
+            }
+            char *sq = static_cast<char *>(sq_ptr);
+            char *cq = static_cast<char *>(cq_ptr);
+            sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+            sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+            sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+            cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+            cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+            cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+            sqes = static_cast<struct io_uring_sqe *>(sqes_ptr);
+            ring_fd = fd;
+        }
+    };
+#endif
+
+    // 收集一个目录中的条目, 再一次性取得它们的元数据 (字段同 stat_basic);
+    // Linux 上启用 io_uring 时按批提交 statx, 每批一次提交与收割; 未启用或不可用时条目较多则分给线程池, 否则逐个 statx;
+    // Windows 与其他平台在登记时直接取元数据 (Windows 取自枚举数据, 没有额外调用);
+    // follow 为 true 时跟随失败的条目 (如失效的链接) 再不跟随取一次, 按链接自身报告
+    class StatBatch
+    {
+    public:
+        // 线程池后端只在条目数不少于该值时启用
+        static constexpr size_t ParallelThreshold = 4096;
+        // 条目很少时一次提交与收割的开销大于逐个 statx
+        static constexpr size_t RingThreshold = 64;
+
+        // threads 为线程池后端的线程数, 0 为硬件线程数, 1 为不使用线程池;
+        // use_ring 为 true 时优先用 io_uring; 缓存命中时内核把 STATX 交给 io-wq 线程执行, 实测比逐个 statx 慢, 默认不用
+        StatBatch(const DirEnumerator &dir, bool follow, size_t threads = 0, bool use_ring = false) : dir(dir), follow(follow), threads(threads), use_ring(use_ring) {}
+
+        // 登记当前条目, 返回其序号
+        size_t Add(const DirEntry &entry)
+        {
+            size_t index = offsets.size();
+            offsets.push_back(arena.size());
+            arena.append(entry.name.data(), entry.name.size());
+            // 以 \0 分隔, 可直接作为 C 字符串交给内核
+            arena.push_back('\0');
+            stats.emplace_back();
+            errors.push_back(0);
+#if defined(_WIN32) || !defined(__linux__)
+            bool good = dir.StatBasic(entry, stats.back(), follow) || (follow && dir.StatBasic(entry, stats.back(), false));
+            ok.push_back(good ? 1 : 0);
+            if (!good)
+            {
+#ifdef _WIN32
+                errors.back() = static_cast<int>(GetLastError());
+#else
+                errors.back() = errno;
+#endif
+            }
+#else
+            ok.push_back(0);
+#endif
+            return index;
+        }
+
+        size_t Size() const
+        {
+            return offsets.size();
+        }
+
+        std::string_view Name(size_t index) const
+        {
+            size_t end = index + 1 < offsets.size() ? offsets[index + 1] - 1 : arena.size() - 1;
+            return std::string_view(arena.data() + offsets[index], end - offsets[index]);
+        }
+
+        bool Ok(size_t index) const
+        {
+            return ok[index] != 0;
+        }
+
+        const EntryStat &Stat(size_t index) const
+        {
+            return stats[index];
+        }
+
+        // Ok 为 false 时的错误
+        std::error_code Error(size_t index) const
+        {
+            return std::error_code(errors[index], std::system_category());
+        }
+
+        // 完成所有登记条目的元数据调用
+        void Run()
+        {
+#if !defined(_WIN32) && defined(__linux__)
+            int fd = dir.GetFd();
+            if (fd < 0 || offsets.empty())
+            {
+                return;
+            }
+            dir.AddStatCalls(offsets.size());
+            int flags = follow ? 0 : AT_SYMLINK_NOFOLLOW;
+#ifdef AM_HAS_IO_URING
+            StatxRing *ring = use_ring && offsets.size() >= RingThreshold ? StatxRing::Local() : nullptr;
+            if (ring && RunRing(*ring, fd, flags))
+            {
+                RetryLinks(fd);
+                return;
+            }
+#endif
+            size_t count = offsets.size();
+            size_t workers = threads == 0 ? std::max<size_t>(1, std::thread::hardware_concurrency()) : threads;
+            if (workers > 1 && count >= ParallelThreshold)
+            {
+                WorkPool pool(workers);
+                size_t chunk = (count + pool.Size() * 4 - 1) / (pool.Size() * 4);
+                pool.Run([&](size_t worker)
+                         {
+                             for (size_t begin = 0; begin < count; begin += chunk)
+                             {
+                                 size_t end = std::min(count, begin + chunk);
+                                 pool.Push(worker, [this, fd, begin, end](size_t)
+                                           { RunRange(fd, begin, end); });
+                             } });
+            }
+            else
+            {
+                RunRange(fd, 0, count);
+            }
+            RetryLinks(fd);
+#endif
+        }
+
+    private:
+        const DirEnumerator &dir;
+        bool follow;
+        size_t threads;
+        bool use_ring;
+        std::string arena;
+        std::vector<size_t> offsets;
+        std::vector<EntryStat> stats;
+        std::vector<uint8_t> ok;
+        std::vector<int> errors;
+
+#if !defined(_WIN32) && defined(__linux__)
+        void RunRange(int fd, size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                ok[i] = stat_at(fd, arena.data() + offsets[i], stats[i], follow) ? 1 : 0;
+                errors[i] = ok[i] ? 0 : errno;
+            }
+        }
+
+        // 跟随失败的条目不跟随再取一次, 失效的链接仍按链接产出
+        void RetryLinks(int fd)
+        {
+            if (!follow)
+            {
+                return;
+            }
+            for (size_t i = 0; i < offsets.size(); i++)
+            {
+                if (!ok[i])
+                {
+                    dir.AddStatCalls(1);
+                    if (stat_at(fd, arena.data() + offsets[i], stats[i], false))
+                    {
+                        ok[i] = 1;
+                        errors[i] = 0;
+                    }
+                }
+            }
+        }
+#endif
+
+#ifdef AM_HAS_IO_URING
+        bool RunRing(StatxRing &ring, int fd, int flags)
+        {
+            for (size_t begin = 0; begin < offsets.size(); begin += StatxRing::Entries)
+            {
+                size_t count = std::min<size_t>(StatxRing::Entries, offsets.size() - begin);
+                for (size_t i = 0; i < count; i++)
+                {
+                    ring.Name(i) = arena.data() + offsets[begin + i];
+                }
+                if (!ring.Run(fd, count, flags))
+                {
+                    // 未完成的部分由其他后端补上
+                    RunRange(fd, begin, offsets.size());
+                    return true;
+                }
+                for (size_t i = 0; i < count; i++)
+                {
+                    size_t index = begin + i;
+                    int result = ring.Result(i);
+                    if (result == -EINVAL || result == -EOPNOTSUPP)
+                    {
+                        // 内核不支持 IORING_OP_STATX (5.6 之前), 之后改用同步调用
+                        StatxRing::Enabled() = false;
+                        RunRange(fd, index, offsets.size());
+                        return true;
+                    }
+                    if (result == 0)
+                    {
+                        fill_entry_statx(ring.Buffer(i), stats[index]);
+                        ok[index] = 1;
+                    }
+                    else
+                    {
+                        errors[index] = -result;
+                    }
+                }
+            }
+            return true;
+        }
+#endif
+    };
+}
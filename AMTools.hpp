@@ -1,8 +1,11 @@
 #pragma once
+#include <filesystem>
 #include <iostream>
 #include <string>
 #include <vector>
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 namespace _AMInternalTools
 {
@@ -34,6 +37,7 @@ namespace _AMInternalTools
         return (remaining == 0);
     }
 
+#ifdef _WIN32
     std::string AMstr(const std::wstring &wstr)
     {
         int codePage = GetACP();
@@ -59,6 +63,18 @@ namespace _AMInternalTools
         MultiByteToWideChar(codePage, 0, str.c_str(), -1, &result[0], len);
         return result;
     };
+#else
+    // 非 Windows 平台的窄字符串即 UTF-8
+    std::string AMstr(const std::wstring &wstr)
+    {
+        return std::filesystem::path(wstr).string();
+    }
+
+    std::wstring AMstr(const std::string &str)
+    {
+        return std::filesystem::path(str).wstring();
+    }
+#endif
 }
 
 template <typename... Args>
@@ -0,0 +1,226 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace AMPathTools
+{
+    // 每个线程一个双端队列: 自己从尾部取 (深度优先), 空闲时从其他线程的头部偷 (广度优先)
+    class WorkPool
+    {
+    public:
+        using Task = std::function<void(size_t worker)>;
+
+        // threads 为 0 时使用硬件线程数
+        explicit WorkPool(size_t threads)
+        {
+            if (threads == 0)
+            {
+                threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+            }
+            for (size_t i = 0; i < threads; i++)
+            {
+                queues.push_back(std::make_unique<Queue>());
+            }
+        }
+
+        size_t Size() const
+        {
+            return queues.size();
+        }
+
+        // 调用线程作为 0 号线程参与执行, 直到 root 及其派生的任务全部完成
+        void Run(Task root)
+        {
+            error = nullptr;
+            pending = 0;
+            Push(0, std::move(root));
+            std::vector<std::thread> workers;
+            for (size_t i = 1; i < queues.size(); i++)
+            {
+                workers.emplace_back([this, i]()
+                                     { Work(i); });
+            }
+            Work(0);
+            for (auto &worker : workers)
+            {
+                worker.join();
+            }
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+
+        // 只能在任务内部调用, worker 为当前任务所在的线程
+        void Push(size_t worker, Task task)
+        {
+            pending++;
+            {
+                std::lock_guard<std::mutex> lock(queues[worker]->mutex);
+                queues[worker]->tasks.push_back(std::move(task));
+                queued++;
+            }
+            {
+                std::lock_guard<std::mutex> lock(wait_mutex);
+            }
+            wait_cv.notify_one();
+        }
+
+    private:
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::atomic<size_t> pending = 0;
+        std::atomic<size_t> queued = 0;
+        std::mutex wait_mutex;
+        std::condition_variable wait_cv;
+        std::mutex error_mutex;
+        std::exception_ptr error;
+
+        bool Pop(size_t worker, Task &task)
+        {
+            Queue &queue = *queues[worker];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty())
+            {
+                return false;
+            }
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            queued--;
+            return true;
+        }
+
+        bool Steal(size_t worker, Task &task)
+        {
+            for (size_t i = 1; i < queues.size(); i++)
+            {
+                Queue &queue = *queues[(worker + i) % queues.size()];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (queue.tasks.empty())
+                {
+                    continue;
+                }
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                queued--;
+                return true;
+            }
+            return false;
+        }
+
+        void Work(size_t worker)
+        {
+            while (true)
+            {
+                Task task;
+                if (Pop(worker, task) || Steal(worker, task))
+                {
+                    try
+                    {
+                        task(worker);
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard<std::mutex> lock(error_mutex);
+                        if (!error)
+                        {
+                            error = std::current_exception();
+                        }
+                    }
+                    if (--pending == 0)
+                    {
+                        {
+                            std::lock_guard<std::mutex> lock(wait_mutex);
+                        }
+                        wait_cv.notify_all();
+                    }
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(wait_mutex);
+                wait_cv.wait(lock, [this]()
+                             { return pending == 0 || queued > 0; });
+                if (pending == 0)
+                {
+                    return;
+                }
+            }
+        }
+    };
+
+    // 生产者与消费者之间的有界队列: 队列满时 Push 阻塞, 以此对生产者施加背压
+    template <typename T>
+    class BoundedQueue
+    {
+    public:
+        explicit BoundedQueue(size_t capacity) : capacity(std::max<size_t>(1, capacity)) {}
+
+        // 被取消后返回 false, 生产者应停止
+        bool Push(T value)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            not_full.wait(lock, [this]()
+                          { return cancelled || items.size() < capacity; });
+            if (cancelled)
+            {
+                return false;
+            }
+            items.push_back(std::move(value));
+            not_empty.notify_one();
+            return true;
+        }
+
+        // 队列为空且生产者已结束, 或已被取消时返回 false
+        bool Pop(T &value)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            not_empty.wait(lock, [this]()
+                           { return cancelled || finished || !items.empty(); });
+            if (cancelled || items.empty())
+            {
+                return false;
+            }
+            value = std::move(items.front());
+            items.pop_front();
+            not_full.notify_one();
+            return true;
+        }
+
+        void Finish()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished = true;
+            not_empty.notify_all();
+        }
+
+        void Cancel()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            cancelled = true;
+            items.clear();
+            not_full.notify_all();
+            not_empty.notify_all();
+        }
+
+    private:
+        size_t capacity;
+        std::deque<T> items;
+        bool finished = false;
+        bool cancelled = false;
+        std::mutex mutex;
+        std::condition_variable not_full;
+        std::condition_variable not_empty;
+    };
+}
@@ -1,6 +1,7 @@
 from __future__ import annotations
+import numpy
 import typing
-__all__ = ['ExplorerAPI', 'FileOperationResult', 'FileOperationSet', 'FileOperationStatus', 'FileOperationType', 'SingleFileOperation']
+__all__ = ['ExplorerAPI', 'FileOperationResult', 'FileOperationSet', 'FileOperationStatus', 'FileOperationType', 'PathInfoTable', 'STAT_ALL', 'STAT_MODE', 'STAT_NAME', 'STAT_OWNER', 'STAT_SIZE', 'STAT_TIMES', 'SingleFileOperation', 'listdir', 'walk']
 class ExplorerAPI:
     @typing.overload
     def Clone(self, src: str, dst: str, mkdir: bool = True, tmp_set: FileOperationSet = None) -> tuple[FileOperationResult, str]:
@@ -264,9 +265,42 @@ class FileOperationType:
     @property
     def value(self) -> int:
         ...
+class PathInfoTable:
+    def Columns(self) -> dict[str, numpy.ndarray]:
+        """
+        Read-only, zero-copy views of the numeric columns: size / atime / mtime (uint64), type (int8), mode / mode_id / owner_id / dir_id (uint32)
+        """
+    def Dirs(self) -> list[str]:
+        ...
+    def MemoryUsage(self) -> int:
+        ...
+    def ModeStrs(self) -> list[str]:
+        ...
+    def Name(self, row: int) -> str:
+        ...
+    def Names(self) -> tuple[numpy.ndarray, numpy.ndarray]:
+        """
+        Arrow-style names: (offsets uint64 of length n + 1, UTF-8 bytes uint8), both zero-copy
+        """
+    def Owners(self) -> list[str]:
+        ...
+    def Path(self, row: int) -> str:
+        ...
+    def __len__(self) -> int:
+        ...
 class SingleFileOperation:
     action: FileOperationType
     dst_dir: str
     dst_name: str
     mkdir: bool
     src: str
+def listdir(path: str, fields: int = 31) -> PathInfoTable:
+    ...
+def walk(path: str, ignore_special_file: bool = False, trace_link: bool = False, threads: int = 1, fields: int = 31, follow_root: bool = True) -> PathInfoTable:
+    ...
+STAT_ALL: int = 31
+STAT_MODE: int = 16
+STAT_NAME: int = 1
+STAT_OWNER: int = 8
+STAT_SIZE: int = 2
+STAT_TIMES: int = 4
@@ -0,0 +1,117 @@
+# WinFile.listdir / WinFile.walk 导出的 PathInfoTable 检查:
+# Columns() 的数组零拷贝, 只读, 表对象释放后仍可用; Names() 的 offsets/bytes 与 Name(i) 一致; walk 的行数与目录树一致;
+# 根目录为链接时 follow_root 的行为. 构建 WinFile 扩展后运行 python check_table.py, 全部通过时输出 OK
+import gc
+import os
+import shutil
+import sys
+import tempfile
+
+import numpy as np
+import WinFile
+
+
+def make_tree(root, depth, files):
+    count = 0
+    os.makedirs(root, exist_ok=True)
+    for i in range(files):
+        with open(os.path.join(root, f"f{i}.txt"), "wb") as f:
+            f.write(b"x" * (i + 1))
+        count += 1
+    # 非 ASCII 名字, 检查 UTF-8 字节与 Name(i) 的往返
+    with open(os.path.join(root, "报告_ü.txt"), "wb") as f:
+        f.write(b"y")
+    count += 1
+    if depth > 0:
+        for sub in ("a", "b", "c"):
+            count += 1 + make_tree(os.path.join(root, sub), depth - 1, files)
+    return count
+
+
+def check_columns(table):
+    n = len(table)
+    columns = table.Columns()
+    for name, array in columns.items():
+        assert array.shape == (n,), (name, array.shape, n)
+        assert not array.flags.owndata, name
+        assert not array.flags.writeable, name
+        assert isinstance(array.base, WinFile.PathInfoTable), (name, type(array.base))
+        try:
+            array[:1] = 0
+        except ValueError:
+            pass
+        else:
+            raise AssertionError(f"{name} is writeable")
+    assert columns["size"].dtype == np.uint64 and columns["type"].dtype == np.int8 and columns["dir_id"].dtype == np.uint32
+
+
+def check_names(table):
+    offsets, data = table.Names()
+    assert offsets.dtype == np.uint64 and data.dtype == np.uint8
+    assert len(offsets) == len(table) + 1 and offsets[0] == 0 and offsets[-1] == data.nbytes
+    for i in range(len(table)):
+        name = data[offsets[i] : offsets[i + 1]].tobytes().decode("utf-8")
+        assert name == table.Name(i), (i, name, table.Name(i))
+        assert table.Path(i).endswith(name), (i, table.Path(i), name)
+
+
+def main():
+    root = tempfile.mkdtemp(prefix="winfile_table_")
+    try:
+        entries = make_tree(root, 3, 4)
+        expect = 1 + sum(len(dirs) + len(files) for _, dirs, files in os.walk(root))
+        assert expect == 1 + entries, (expect, entries)
+
+        for threads in (1, 4):
+            table = WinFile.walk(root, threads=threads)
+            assert len(table) == expect, (threads, len(table), expect)
+            check_columns(table)
+            check_names(table)
+
+        # 释放表对象后数组仍引用原来的存储
+        table = WinFile.walk(root)
+        columns = table.Columns()
+        offsets, data = table.Names()
+        sizes = columns["size"].copy()
+        names = [table.Name(i) for i in range(len(table))]
+        del table
+        gc.collect()
+        assert np.array_equal(columns["size"], sizes)
+        assert [data[offsets[i] : offsets[i + 1]].tobytes().decode("utf-8") for i in range(len(names))] == names
+
+        # 根目录本身是链接: 默认跟随, follow_root=False 时只产出链接自身; 没有创建链接的权限时跳过
+        link = root + "_link"
+        try:
+            os.symlink(root, link, target_is_directory=True)
+        except OSError:
+            link = None
+        if link:
+            try:
+                assert len(WinFile.walk(link)) == expect, len(WinFile.walk(link))
+                assert len(WinFile.walk(link, follow_root=False)) == 1
+            finally:
+                os.unlink(link)
+
+        listing = WinFile.listdir(root)
+        assert len(listing) == len(os.listdir(root)), (len(listing), len(os.listdir(root)))
+        check_columns(listing)
+        check_names(listing)
+        size_by_name = {listing.Name(i): int(listing.Columns()["size"][i]) for i in range(len(listing))}
+        assert size_by_name["f3.txt"] == 4, size_by_name
+
+        empty = WinFile.listdir(os.path.join(root, "missing"))
+        assert len(empty) == 0 and empty.Columns()["size"].shape == (0,) and len(empty.Names()[0]) == 1
+        try:
+            empty.Name(0)
+        except IndexError:
+            pass
+        else:
+            raise AssertionError("Name(0) on an empty table")
+    finally:
+        shutil.rmtree(root, ignore_errors=True)
+    print("OK")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
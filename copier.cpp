@@ -1,3 +1,4 @@
+#include "AMPath.hpp"
 #include "AMTracer.hpp"
 #include <filesystem>
 #include <fmt/core.h>
@@ -6,6 +7,7 @@
 #include <magic_enum/magic_enum.hpp>
 #include <pybind11/complex.h>
 #include <pybind11/functional.h>
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <regex>
@@ -870,6 +872,40 @@ public:
     }
 };
 
+// 以只读 ndarray 暴露表中的一列, 不复制数据; owner 为表对象, 数组存活期间表不会被释放
+template <typename T>
+py::array ColumnArray(const T *data, size_t size, py::handle owner)
+{
+    static const T empty{};
+    py::array array(py::dtype::of<T>(), {static_cast<py::ssize_t>(size)}, {static_cast<py::ssize_t>(sizeof(T))}, size ? data : &empty, owner);
+    array.attr("setflags")(py::arg("write") = false);
+    return array;
+}
+
+template <typename T>
+py::array ColumnArray(const std::vector<T> &column, py::handle owner)
+{
+    return ColumnArray(column.data(), column.size(), owner);
+}
+
+// 名字按 Arrow 的方式导出: offsets (uint64, 长度 n + 1) 与 UTF-8 字节 (uint8)
+py::tuple NameArrays(const AMPath::PathInfoTable &table, py::handle owner)
+{
+    const std::string &bytes = table.NameBytes();
+    return py::make_tuple(ColumnArray(table.NameOffsets(), owner), ColumnArray(reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size(), owner));
+}
+
+py::list ValueList(size_t count, const std::function<std::string_view(uint32_t)> &get)
+{
+    py::list values;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        std::string_view value = get(i);
+        values.append(py::str(value.data(), value.size()));
+    }
+    return values;
+}
+
 PYBIND11_MODULE(WinFile, m)
 {
     py::enum_<FileOperationStatus>(m, "FileOperationStatus")
@@ -961,4 +997,68 @@ PYBIND11_MODULE(WinFile, m)
         .def("Conduct", py::overload_cast<SingleFileOperation &, sptr>(&ExplorerAPI::Conduct), py::arg("operation"), py::arg("tmp_set") = nullptr)
         .def("Conduct", py::overload_cast<std::vector<SingleFileOperation> &, sptr>(&ExplorerAPI::Conduct), py::arg("operations"), py::arg("tmp_set") = nullptr)
         .def_readonly("Tracer", &ExplorerAPI::Tracer);
+
+    m.attr("STAT_NAME") = AMPath::STAT_NAME;
+    m.attr("STAT_SIZE") = AMPath::STAT_SIZE;
+    m.attr("STAT_TIMES") = AMPath::STAT_TIMES;
+    m.attr("STAT_OWNER") = AMPath::STAT_OWNER;
+    m.attr("STAT_MODE") = AMPath::STAT_MODE;
+    m.attr("STAT_ALL") = AMPath::STAT_ALL;
+
+    // 导出的数组直接引用表内的存储, 表只读, 不提供修改接口
+    py::class_<AMPath::PathInfoTable>(m, "PathInfoTable")
+        .def("__len__", &AMPath::PathInfoTable::Size)
+        .def("Columns", [](py::object self)
+             {
+                 auto &table = self.cast<const AMPath::PathInfoTable &>();
+                 py::dict columns;
+                 columns["size"] = ColumnArray(table.Sizes(), self);
+                 columns["atime"] = ColumnArray(table.Atimes(), self);
+                 columns["mtime"] = ColumnArray(table.Mtimes(), self);
+                 columns["type"] = ColumnArray(table.Types(), self);
+                 columns["mode"] = ColumnArray(table.Modes(), self);
+                 columns["mode_id"] = ColumnArray(table.ModeIds(), self);
+                 columns["owner_id"] = ColumnArray(table.OwnerIds(), self);
+                 columns["dir_id"] = ColumnArray(table.DirIds(), self);
+                 return columns; })
+        .def("Names", [](py::object self)
+             { return NameArrays(self.cast<const AMPath::PathInfoTable &>(), self); })
+        .def("Dirs", [](const AMPath::PathInfoTable &table)
+             { return ValueList(table.DirCount(), [&table](uint32_t id)
+                                { return table.DirName(id); }); })
+        .def("Owners", [](const AMPath::PathInfoTable &table)
+             { return ValueList(table.OwnerCount(), [&table](uint32_t id)
+                                { return table.OwnerName(id); }); })
+        .def("ModeStrs", [](const AMPath::PathInfoTable &table)
+             { return ValueList(table.ModeStrCount(), [&table](uint32_t id)
+                                { return table.ModeStrName(id); }); })
+        .def("Name", [](const AMPath::PathInfoTable &table, size_t row)
+             {
+                 if (row >= table.Size())
+                 {
+                     throw py::index_error("row out of range");
+                 }
+                 std::string_view name = table.Name(row);
+                 return py::str(name.data(), name.size()); }, py::arg("row"))
+        .def("Path", [](const AMPath::PathInfoTable &table, size_t row)
+             {
+                 if (row >= table.Size())
+                 {
+                     throw py::index_error("row out of range");
+                 }
+                 return table.Path(row); }, py::arg("row"))
+        .def("MemoryUsage", &AMPath::PathInfoTable::MemoryUsage);
+
+    // 枚举与遍历不涉及 Python 对象, 期间释放 GIL
+    m.def("listdir", [](const std::string &path, uint32_t fields)
+          { return AMPath::listdir_table(path, fields); }, py::arg("path"), py::arg("fields") = AMPath::STAT_ALL, py::call_guard<py::gil_scoped_release>());
+    m.def("walk", [](const std::string &path, bool ignore_special_file, bool trace_link, size_t threads, uint32_t fields, bool follow_root)
+          {
+              AMPath::WalkOptions options;
+              options.ignore_sepcial_file = ignore_special_file;
+              options.trace_link = trace_link;
+              options.follow_root = follow_root;
+              options.threads = threads;
+              options.fields = fields;
+              return AMPath::walk_table(path, options); }, py::arg("path"), py::arg("ignore_special_file") = false, py::arg("trace_link") = false, py::arg("threads") = 1, py::arg("fields") = AMPath::STAT_ALL, py::arg("follow_root") = true, py::call_guard<py::gil_scoped_release>());
 }
@@ -776,7 +776,26 @@ namespace CliFunc
 {
     void OriCallback(std::string src, std::string error, std::string msg) {}
 
-    void CopyMove(FileOperationType oper, std::vector<std::string> &paths, CliPara::Options &opt, std::vector<SingleFileOperation> &tasks, std::shared_ptr<std::function<void(std::string, std::string, std::string)>> cb)
+    struct TaskCount
+    {
+        size_t found = 0;
+        size_t pended = 0;
+    };
+
+    void Pend(ExplorerAPI &exp, SingleFileOperation task, TaskCount &count)
+    {
+        count.found++;
+        ECM ecm = exp.PendOperation(task);
+        if (ecm.first != FileOperationResult::SUCCESS)
+        {
+            std::cerr << GetECName(ecm.first) << ": " << ecm.second << std::endl;
+            return;
+        }
+        count.pended++;
+    }
+
+    // 边查找边提交操作, 不必等遍历结束, 也不保留完整的匹配列表
+    void CopyMove(FileOperationType oper, std::vector<std::string> &paths, CliPara::Options &opt, ExplorerAPI &exp, TaskCount &count, std::shared_ptr<std::function<void(std::string, std::string, std::string)>> cb)
     {
         std::vector<std::string> srcs;
         std::string dst;
@@ -796,24 +815,22 @@ namespace CliFunc
             srcs.pop_back();
         }
 
-        for (auto src : srcs)
+        AMPath::FindStream stream(srcs, opt.srh, opt.regex, opt.quiet, cb);
+        std::string path;
+        while (stream.Next(path))
         {
-            for (auto path : AMPath::find(src, opt.srh, opt.regex, opt.quiet, cb))
-            {
-                amprint("path_matched: ", path);
-                tasks.emplace_back(SingleFileOperation(oper, src, dst, "", opt.mkdir));
-            }
+            amprint("path_matched: ", path);
+            Pend(exp, SingleFileOperation(oper, path, dst, "", opt.mkdir), count);
         }
     }
 
-    void Remove(FileOperationType oper, std::vector<std::string> &paths, CliPara::Options &opt, std::vector<SingleFileOperation> &tasks, std::shared_ptr<std::function<void(std::string, std::string, std::string)>> cb)
+    void Remove(FileOperationType oper, std::vector<std::string> &paths, CliPara::Options &opt, ExplorerAPI &exp, TaskCount &count, std::shared_ptr<std::function<void(std::string, std::string, std::string)>> cb)
     {
-        for (auto src : paths)
+        AMPath::FindStream stream(paths, opt.srh, opt.regex, opt.quiet, cb);
+        std::string path;
+        while (stream.Next(path))
         {
-            for (auto path : AMPath::find(src, opt.srh, opt.regex, opt.quiet, cb))
-            {
-                tasks.emplace_back(SingleFileOperation(FileOperationType::REMOVE, src, "", "", opt.mkdir));
-            }
+            Pend(exp, SingleFileOperation(FileOperationType::REMOVE, path, "", "", opt.mkdir), count);
         }
     }
 
@@ -971,10 +988,20 @@ int main(int argc, char **argv)
         call_ptr = std::make_shared<CB>(CliFunc::OriCallback);
     }
 
+    // 先初始化文件操作接口, 查找到的路径可以直接提交
+    auto exp = ExplorerAPI();
+    ECM ecm = exp.Init(opt.set);
+    if (ecm.first != EC::SUCCESS)
+    {
+        std::cerr << GetECName(ecm.first) << ": " << ecm.second;
+        exit(static_cast<int>(ecm.first));
+    }
+
+    CliFunc::TaskCount count;
     std::vector<task> TASKS;
     if (copy_cmd->parsed())
     {
-        CliFunc::CopyMove(op::COPY, cp_paths, opt, TASKS, call_ptr);
+        CliFunc::CopyMove(op::COPY, cp_paths, opt, exp, count, call_ptr);
     }
     else if (clone_cmd->parsed())
     {
@@ -982,7 +1009,7 @@ int main(int argc, char **argv)
     }
     else if (move_cmd->parsed())
     {
-        CliFunc::CopyMove(op::MOVE, mv_paths, opt, TASKS, call_ptr);
+        CliFunc::CopyMove(op::MOVE, mv_paths, opt, exp, count, call_ptr);
     }
     else if (replace_cmd->parsed())
     {
@@ -990,7 +1017,7 @@ int main(int argc, char **argv)
     }
     else if (remove_cmd->parsed())
     {
-        CliFunc::Remove(op::REMOVE, rm_paths, opt, TASKS, call_ptr);
+        CliFunc::Remove(op::REMOVE, rm_paths, opt, exp, count, call_ptr);
     }
     else if (rename_cmd->parsed())
     {
@@ -1007,32 +1034,16 @@ int main(int argc, char **argv)
         exit(-1);
     }
 
-    if (TASKS.empty())
+    for (auto task_i : TASKS)
     {
-        std::cerr << "TaskLoadError: No tasks get!" << std::endl;
-        exit(-2);
+        CliFunc::Pend(exp, task_i, count);
     }
-    auto exp = ExplorerAPI();
-    ECM ecm = exp.Init(opt.set);
-    if (ecm.first != EC::SUCCESS)
+    if (count.found == 0)
     {
-        std::cerr << GetECName(ecm.first) << ": " << ecm.second;
-        exit(static_cast<int>(ecm.first));
-    }
-    bool has_task = false;
-    for (auto task_i : TASKS)
-    {
-        ecm = exp.PendOperation(task_i);
-        if (ecm.first != EC::SUCCESS)
-        {
-            std::cerr << GetECName(ecm.first) << ": " << ecm.second << std::endl;
-        }
-        else
-        {
-            has_task = true;
-        }
+        std::cerr << "TaskLoadError: No tasks get!" << std::endl;
+        exit(-2);
     }
-    if (!has_task)
+    if (count.pended == 0)
     {
         std::cerr << "TaskLoadError: All tasks load failed!" << std::endl;
         exit(-2);